@@ -4,9 +4,11 @@
 #include <eosio/asset.hpp>
 #include <eosio/crypto.hpp>
 #include <eosio/transaction.hpp>
+#include <eosio/binary_extension.hpp>
 
 #include <atomicassets-interface.hpp>
 #include <ram-interface.hpp>
+#include <roll-outcomes.hpp>
 #include <wax-orng-interface.hpp>
 
 using namespace std;
@@ -15,13 +17,66 @@ using namespace eosio;
 static constexpr name   CORE_TOKEN_ACCOUNT = name("eosio.token");
 static constexpr symbol CORE_TOKEN_SYMBOL  = symbol("WAX", 8);
 
+static constexpr uint64_t MAX_PACKS_PER_UNBOX      = 20;
+static constexpr uint64_t MAX_DIRECT_MINT_ROLLS    = 10;
+static constexpr int      MAX_SIGNING_VALUE_PROBES = 16;
+static constexpr uint64_t MAX_UNBOX_DRAWS_PER_STEP = 200; //Packs with more rolls are unboxed in multiple steps
+
+//Flags that can be set for a pack when completing it
+static constexpr uint32_t UNBOX_FLAG_DIRECT_MINT      = 1 << 0; //Mint the results in receiverand instead of storing them
+static constexpr uint32_t UNBOX_FLAG_PACKED_RESULTS   = 1 << 1; //Store all results in a single unboxresults row
+static constexpr uint32_t UNBOX_FLAG_LEAN_UNBOXPACKS  = 1 << 2; //Store unboxpacks entries without the unboxer index
+static constexpr uint32_t UNBOX_FLAG_DEFERRED_RESULTS = 1 << 3; //Only store the seed, results are drawn when claiming
+static constexpr uint32_t SUPPORTED_UNBOX_FLAGS       = UNBOX_FLAG_DIRECT_MINT | UNBOX_FLAG_PACKED_RESULTS
+    | UNBOX_FLAG_LEAN_UNBOXPACKS | UNBOX_FLAG_DEFERRED_RESULTS;
+
 CONTRACT atomicpacks : public contract {
 public:
     using contract::contract;
 
-    struct OUTCOME {
-        uint32_t odds;
-        int32_t  template_id; //-1 is equal to no NFT being minted
+    ~atomicpacks();
+
+    struct ROLL_DATA {
+        vector <OUTCOME> outcomes;
+        uint32_t         total_odds;
+        uint32_t         count;
+    };
+
+    struct BUNDLE_ROLL {
+        uint64_t         roll_id;     //Origin roll id of the first draw of the roll within the chunk
+        uint32_t         count;       //Number of draws of the roll within the chunk
+        uint32_t         total_odds;
+        vector <uint8_t> alias_table; //Encoded with encode_alias_table
+    };
+
+    struct UNBOX_RESULT {
+        uint64_t origin_roll_id;
+        int32_t  template_id;
+    };
+
+    struct UNBOX_PROFILE {
+        uint64_t roll_count;         //Total number of rolls, taking the count of each roll into account
+        int64_t  reserved_ram_bytes; //RAM bytes reserved from the collection's balance when opening a pack
+        bool     can_mint;           //Whether at least one outcome has a template id other than -1
+    };
+
+    struct UNBOX_SEED {
+        checksum256      seed;
+        vector <uint8_t> claimed_rolls; //Bitmap of the claimed rolls, in the order in which they are drawn
+    };
+
+    struct TEMPLATE_ODDS {
+        int32_t template_id;
+        double  expected_count; //Expected number of assets of this template per opened pack
+        double  probability;    //Probability that an opened pack contains at least one asset of this template
+    };
+
+    struct UNBOX_COST {
+        uint64_t roll_count;
+        double   expected_mint_count;
+        int64_t  reserved_ram_bytes;      //Reserved when opening the pack, partly freed once the results are claimed
+        int64_t  request_ram_bytes;       //Used by the randomness request, the jobs row is freed when it is answered
+        double   expected_mint_ram_bytes; //Used by the minted assets when the results are claimed
     };
 
     struct RAM_REFUND_DATA {
@@ -51,7 +106,14 @@ public:
         name authorized_account,
         uint64_t pack_id,
         vector <OUTCOME> outcomes,
-        uint32_t total_odds
+        uint32_t total_odds,
+        binary_extension <uint32_t> count
+    );
+
+    ACTION addpackrolls(
+        name authorized_account,
+        uint64_t pack_id,
+        vector <ROLL_DATA> rolls
     );
 
     ACTION delpackroll(
@@ -63,7 +125,8 @@ public:
     ACTION completepack(
         name authorized_account,
         uint64_t pack_id,
-        int32_t pack_template_id
+        int32_t pack_template_id,
+        binary_extension <uint32_t> unbox_flags
     );
 
     ACTION setpacktime(
@@ -84,6 +147,20 @@ public:
         vector <uint64_t> origin_roll_ids
     );
 
+    ACTION claimall(
+        name unboxer,
+        uint32_t max_claims
+    );
+
+    ACTION resumeunbox(
+        uint64_t pack_asset_id
+    );
+
+    [[eosio::action]] uint64_t claimpending(
+        uint64_t start_pack_asset_id,
+        uint32_t budget
+    );
+
 
     ACTION lognewpack(
         uint64_t pack_id,
@@ -96,6 +173,11 @@ public:
         uint64_t roll_id
     );
 
+    ACTION lognewrolls(
+        uint64_t pack_id,
+        vector <uint64_t> roll_ids
+    );
+
     ACTION logresult(
         uint64_t pack_asset_id,
         uint64_t pack_id,
@@ -123,6 +205,20 @@ public:
     );
 
 
+    [[eosio::action, eosio::read_only]] vector <TEMPLATE_ODDS> getpackodds(
+        uint64_t pack_id
+    );
+
+    [[eosio::action, eosio::read_only]] UNBOX_COST getunboxcost(
+        uint64_t pack_id
+    );
+
+    [[eosio::action, eosio::read_only]] vector <UNBOX_RESULT> previewunbox(
+        uint64_t pack_id,
+        checksum256 seed
+    );
+
+
     ACTION receiverand(
         uint64_t assoc_id,
         checksum256 random_value
@@ -152,6 +248,8 @@ private:
         int32_t  pack_template_id  = -1; //-1 if the pack has not been activated yet
         uint64_t roll_counter = 0;
         string   display_data;
+        binary_extension <uint32_t>      unbox_flags;   //Set when the pack is completed
+        binary_extension <UNBOX_PROFILE> unbox_profile; //Set when the pack is completed
 
         uint64_t primary_key() const { return pack_id; }
 
@@ -168,6 +266,8 @@ private:
         uint64_t         roll_id;
         vector <OUTCOME> outcomes;
         uint32_t         total_odds;
+        binary_extension <uint32_t> count; //Number of times the roll is drawn, 1 if not set
+        binary_extension <vector <uint8_t>> packed_outcomes; //If set, used instead of the (empty) outcomes
 
         uint64_t primary_key() const { return roll_id; }
     };
@@ -175,10 +275,37 @@ private:
     typedef multi_index<name("packrolls"), packrolls_s> packrolls_t;
 
 
+    //Summary of the bundle chunks of a pack, built when the pack is completed
+    TABLE packbundles_s {
+        uint64_t    pack_id;
+        uint32_t    num_chunks;
+        checksum256 content_hash; //sha256 of the concatenated serialized bundlechunks rows, in the order of their keys
+
+        uint64_t primary_key() const { return pack_id; }
+    };
+
+    typedef multi_index<name("packbundles"), packbundles_s> packbundles_t;
+
+
+    //Scope pack id
+    //Alias tables of the rolls of a completed pack, split into chunks of MAX_UNBOX_DRAWS_PER_STEP draws, so that
+    //each unbox step only reads the chunk it draws from. A roll drawn in multiple chunks is part of each of them
+    TABLE bundlechunks_s {
+        uint64_t             first_roll_id; //The previous chunk only has draws with lower origin roll ids
+        vector <BUNDLE_ROLL> rolls;         //Sorted by roll id
+        bool                 last_chunk;    //No other chunk follows, so drawing can stop without reading further rows
+
+        uint64_t primary_key() const { return first_roll_id; }
+    };
+
+    typedef multi_index<name("bundlechunks"), bundlechunks_s> bundlechunks_t;
+
+
     TABLE unboxpacks_s {
         uint64_t pack_asset_id;
         uint64_t pack_id;
         name     unboxer;
+        binary_extension <UNBOX_SEED> unbox_seed; //Set in receiverand for packs with the deferred results flag
 
         uint64_t primary_key() const { return pack_asset_id; }
         uint64_t by_unboxer() const { return unboxer.value; }
@@ -188,6 +315,36 @@ private:
         indexed_by < name("unboxer"), const_mem_fun < unboxpacks_s, uint64_t, &unboxpacks_s::by_unboxer>>>
     unboxpacks_t;
 
+    //Used instead of unboxpacks for packs with the lean unboxpacks flag
+    //Without the unboxer index, each entry is 128 bytes cheaper
+    typedef multi_index<name("leanunboxes"), unboxpacks_s> leanunboxes_t;
+
+
+    //Only used when more than one pack is opened with a single transfer
+    //The assoc id is the asset id of the first pack, which is used for the randomness request
+    TABLE unboxbatches_s {
+        uint64_t          assoc_id;
+        vector <uint64_t> pack_asset_ids;
+
+        uint64_t primary_key() const { return assoc_id; }
+    };
+
+    typedef multi_index<name("unboxbatches"), unboxbatches_s> unboxbatches_t;
+
+
+    //Only used for packs that have too many rolls to be unboxed in a single action
+    //Stores the progress of the unboxing until all rolls have been drawn
+    TABLE unboxcursors_s {
+        uint64_t    pack_asset_id;
+        checksum256 seed;
+        uint64_t    rand_position; //Number of 64 bit values already taken from the randomness provider
+        uint64_t    next_roll_id;  //Origin roll id of the next roll to draw
+
+        uint64_t primary_key() const { return pack_asset_id; }
+    };
+
+    typedef multi_index<name("unboxcursors"), unboxcursors_s> unboxcursors_t;
+
 
     //Scope asset id of pack opened
     TABLE unboxassets_s {
@@ -200,6 +357,17 @@ private:
     typedef multi_index<name("unboxassets"), unboxassets_s> unboxassets_t;
 
 
+    //Used instead of unboxassets for packs with the packed results flag
+    TABLE unboxresults_s {
+        uint64_t              pack_asset_id;
+        vector <UNBOX_RESULT> results;
+
+        uint64_t primary_key() const { return pack_asset_id; }
+    };
+
+    typedef multi_index<name("unboxresults"), unboxresults_s> unboxresults_t;
+
+
     TABLE rambalances_s {
         name    collection_name;
         int64_t byte_balance;
@@ -220,6 +388,14 @@ private:
     typedef multi_index<name("ramrefunds"), ramrefunds_s> ramrefunds_t;
 
 
+    TABLE config_s {
+        uint64_t signing_value_counter = 0;
+    };
+    typedef singleton <name("config"), config_s> config_t;
+    // https://github.com/EOSIO/eosio.cdt/issues/280
+    typedef multi_index <name("config"), config_s> config_t_for_abi;
+
+
     TABLE identifier_s {
         string contract_type = "atomicpacks";
         string version = "1.2.0";
@@ -229,19 +405,172 @@ private:
     typedef multi_index <name("identifier"), identifier_s> identifier_t_for_abi;
 
 
-    packs_t       packs       = packs_t(get_self(), get_self().value);
-    unboxpacks_t  unboxpacks  = unboxpacks_t(get_self(), get_self().value);
-    rambalances_t rambalances = rambalances_t(get_self(), get_self().value);
-    ramrefunds_t  ramrefunds  = ramrefunds_t(get_self(), get_self().value);
-    identifier_t  identifier  = identifier_t(get_self(), get_self().value);
+    //Not a table, only used to cache template reads during a single action
+    struct TEMPLATE_MINT_DATA {
+        name     schema_name;
+        uint32_t max_supply;
+    };
+
+    map <pair <uint64_t, int32_t>, TEMPLATE_MINT_DATA> template_mint_cache = {};
+
+    //Serialized size of the fixed size fields at the beginning of an atomicassets templates row, up to max_supply
+    //This relies on the field order of templates_s in atomicassets-interface.hpp matching the atomicassets contract
+    static constexpr size_t TEMPLATE_MINT_DATA_BYTES =
+        sizeof(atomicassets::templates_s::template_id) + sizeof(atomicassets::templates_s::schema_name)
+        + sizeof(atomicassets::templates_s::transferable) + sizeof(atomicassets::templates_s::burnable)
+        + sizeof(atomicassets::templates_s::max_supply);
+    static_assert(TEMPLATE_MINT_DATA_BYTES == 18, "atomicassets templates row layout changed");
+
+    //Not a table, collects the changes to the collection RAM balances during a single action
+    struct RAM_BALANCE_DELTA {
+        int64_t bytes = 0;
+        string  error_message; //Used if the balance is insufficient for a net decrease
+    };
+
+    map <name, RAM_BALANCE_DELTA> ram_balance_deltas = {};
+
+    //RAM cost model, derived from the serialized sizes of the table rows
+    //Each row is billed with a fixed overhead on top of its serialized data. Table scopes and secondary index
+    //entries (overhead + secondary key + primary key) are billed separately
+    static constexpr int64_t ROW_OVERHEAD_BYTES    = 112;
+    static constexpr int64_t SCOPE_BYTES           = 112;
+    static constexpr int64_t SECONDARY_INDEX_BYTES = ROW_OVERHEAD_BYTES + 2 * sizeof(uint64_t);
+
+    static constexpr int64_t UNBOXASSETS_ROW_BYTES = ROW_OVERHEAD_BYTES
+        + sizeof(unboxassets_s::origin_roll_id) + sizeof(unboxassets_s::template_id);
+    static constexpr int64_t UNBOXPACKS_ROW_BYTES = ROW_OVERHEAD_BYTES
+        + sizeof(unboxpacks_s::pack_asset_id) + sizeof(unboxpacks_s::pack_id) + sizeof(unboxpacks_s::unboxer)
+        + SECONDARY_INDEX_BYTES;
+    static constexpr int64_t LEAN_UNBOXPACKS_ROW_BYTES = UNBOXPACKS_ROW_BYTES - SECONDARY_INDEX_BYTES;
+    static constexpr int64_t UNBOX_RESULT_BYTES =
+        sizeof(UNBOX_RESULT::origin_roll_id) + sizeof(UNBOX_RESULT::template_id);
+    static constexpr int64_t UNBOXCURSORS_ROW_BYTES = ROW_OVERHEAD_BYTES
+        + sizeof(unboxcursors_s::pack_asset_id) + sizeof(unboxcursors_s::seed)
+        + sizeof(unboxcursors_s::rand_position) + sizeof(unboxcursors_s::next_roll_id);
+    static constexpr int64_t RAMBALANCES_ROW_BYTES = ROW_OVERHEAD_BYTES
+        + sizeof(rambalances_s::collection_name) + sizeof(rambalances_s::byte_balance);
+
+    //Asset without backed tokens and with empty immutable and mutable data
+    static constexpr int64_t MIN_ASSET_ROW_BYTES = ROW_OVERHEAD_BYTES
+        + sizeof(atomicassets::assets_s::asset_id) + sizeof(atomicassets::assets_s::collection_name)
+        + sizeof(atomicassets::assets_s::schema_name) + sizeof(atomicassets::assets_s::template_id)
+        + sizeof(atomicassets::assets_s::ram_payer) + 3 * get_varint_bytes(0);
+
+    static constexpr int64_t ORNG_SIGNVALS_ROW_BYTES = ROW_OVERHEAD_BYTES + sizeof(orng::signvals_a::signing_value);
+    //The jobs table is not part of the rng oracle interface, its rows have 4 x 8 bytes of data
+    static constexpr int64_t ORNG_JOBS_ROW_BYTES = ROW_OVERHEAD_BYTES + 4 * sizeof(uint64_t);
+
+    //The sizes below are the byte counts that were used before they were derived from the table layouts
+    //If any of these fail, the table layout has changed and the billing needs to be checked again
+    static_assert(UNBOXASSETS_ROW_BYTES == 124, "unboxassets row size changed");
+    static_assert(UNBOXPACKS_ROW_BYTES == 264, "unboxpacks row size changed");
+    static_assert(RAMBALANCES_ROW_BYTES == 128, "rambalances row size changed");
+    static_assert(MIN_ASSET_ROW_BYTES == 151, "atomicassets assets row size changed");
+    static_assert(ORNG_SIGNVALS_ROW_BYTES == 120, "rng oracle signvals row size changed");
+    static_assert(ORNG_JOBS_ROW_BYTES == 144, "rng oracle jobs row size changed");
+
+    //These sizes are only derived from the cost model above and have not been compared to the billed RAM yet
+    //The same applies to the variable size rows below (unboxresults, unboxbatches and the unbox seed)
+    static_assert(LEAN_UNBOXPACKS_ROW_BYTES == 136, "leanunboxes row size changed");
+    static_assert(UNBOXCURSORS_ROW_BYTES == 168, "unboxcursors row size changed");
+
+    static constexpr int64_t get_unboxresults_ram_bytes(uint64_t num_results) {
+        return ROW_OVERHEAD_BYTES + sizeof(unboxresults_s::pack_asset_id)
+            + get_varint_bytes(num_results) + (int64_t) num_results * UNBOX_RESULT_BYTES;
+    }
+
+    //Added to the unboxpacks entry, the bitmap has one bit per roll
+    static constexpr int64_t get_unbox_seed_ram_bytes(uint64_t roll_count) {
+        int64_t bitmap_bytes = (roll_count + 7) / 8;
+        return sizeof(UNBOX_SEED::seed) + get_varint_bytes(bitmap_bytes) + bitmap_bytes;
+    }
+
+    static constexpr int64_t get_unboxbatches_ram_bytes(uint64_t num_packs) {
+        return ROW_OVERHEAD_BYTES + sizeof(unboxbatches_s::assoc_id)
+            + get_varint_bytes(num_packs) + (int64_t) num_packs * sizeof(uint64_t);
+    }
+
+
+    packs_t        packs        = packs_t(get_self(), get_self().value);
+    packbundles_t  packbundles  = packbundles_t(get_self(), get_self().value);
+    unboxpacks_t   unboxpacks   = unboxpacks_t(get_self(), get_self().value);
+    leanunboxes_t  leanunboxes  = leanunboxes_t(get_self(), get_self().value);
+    unboxbatches_t unboxbatches = unboxbatches_t(get_self(), get_self().value);
+    unboxcursors_t unboxcursors = unboxcursors_t(get_self(), get_self().value);
+    unboxresults_t unboxresults = unboxresults_t(get_self(), get_self().value);
+    rambalances_t  rambalances  = rambalances_t(get_self(), get_self().value);
+    ramrefunds_t   ramrefunds   = ramrefunds_t(get_self(), get_self().value);
+    config_t       config       = config_t(get_self(), get_self().value);
+    identifier_t   identifier   = identifier_t(get_self(), get_self().value);
 
     packrolls_t get_packrolls(uint64_t pack_id);
 
+    bundlechunks_t get_bundlechunks(uint64_t pack_id);
+
+    UNBOX_PROFILE build_unbox_profile(uint64_t pack_id, uint32_t unbox_flags);
+
+    UNBOX_PROFILE get_unbox_profile(const packs_s &pack);
+
     unboxassets_t get_unboxassets(uint64_t pack_asset_id);
 
+    unboxpacks_s get_unboxpack(uint64_t pack_asset_id);
+
+    int64_t erase_unboxpack(uint64_t pack_asset_id);
+
+    void set_unbox_seed(uint64_t pack_asset_id, const UNBOX_SEED &unbox_seed);
+
 
     void check_has_collection_auth(name account_to_check, name collection_name);
 
+    uint64_t get_signing_value(uint64_t assoc_id);
+
+    void check_roll_outcomes(
+        const vector <OUTCOME> &outcomes,
+        uint32_t total_odds,
+        atomicassets::templates_t &col_templates,
+        set <int32_t> &validated_template_ids
+    );
+
+    vector <OUTCOME> get_roll_outcomes(const packrolls_s &roll);
+
+    bool draw_unbox_results(
+        uint64_t pack_id,
+        checksum256 seed,
+        uint64_t &rand_position,
+        uint64_t first_roll_id,
+        uint64_t max_draws,
+        vector <uint64_t> &result_roll_ids,
+        vector <int32_t> &result_template_ids
+    );
+
+    int64_t resolve_unboxpack(
+        uint64_t pack_asset_id,
+        checksum256 seed,
+        map <name, name> &minting_collections
+    );
+
+    vector <UNBOX_RESULT> get_deferred_results(uint64_t pack_asset_id, const unboxpacks_s &unboxpack);
+
+    bool claim_unboxpack_results(
+        const unboxpacks_s &unboxpack,
+        uint32_t &claims_left,
+        map <name, int64_t> &collection_ram_deltas,
+        map <name, name> &minting_collections
+    );
+
+    void apply_collection_ram_deltas(
+        map <name, int64_t> &collection_ram_deltas,
+        const map <name, name> &minting_collections
+    );
+
+    bool mint_unboxed_template(
+        name collection_name,
+        name unboxer,
+        int32_t template_id
+    );
+
+    TEMPLATE_MINT_DATA get_template_mint_data(name collection_name, int32_t template_id);
+
 
     //RAM Handlling
     void increase_ram_balance(name account, int64_t bytes);
@@ -251,4 +580,6 @@ private:
     void increase_collection_ram_balance(name collection_name, int64_t bytes);
 
     void decrease_collection_ram_balance(name collection_name, int64_t bytes, string error_message);
+
+    void settle_collection_ram_balances();
 };
@@ -24,21 +24,85 @@ namespace ram {
     rammarket_t rammarket = rammarket_t(name("eosio"), name("eosio").value);
 
 
+    //A non-negative double, represented as mantissa * 2^exponent with a mantissa of at most 53 bits
+    struct exact_double {
+        uint64_t mantissa;
+        int      exponent;
+    };
+
+    //Rounds mantissa * 2^exponent to a double (nearest, ties to even), as the floating point operations do
+    //sticky signals that the exact value is slightly larger than mantissa * 2^exponent
+    exact_double round_to_double(
+        unsigned __int128 mantissa,
+        int exponent,
+        bool sticky = false
+    ) {
+        uint64_t high = (uint64_t) (mantissa >> 64);
+        int bits = high != 0 ? 128 - __builtin_clzll(high) : 64 - __builtin_clzll((uint64_t) mantissa | 1);
+        if (bits <= 53) {
+            return {(uint64_t) mantissa, exponent};
+        }
+
+        int shift = bits - 53;
+        unsigned __int128 remainder = mantissa & (((unsigned __int128) 1 << shift) - 1);
+        unsigned __int128 half = (unsigned __int128) 1 << (shift - 1);
+        uint64_t rounded = (uint64_t) (mantissa >> shift);
+
+        if (remainder > half || (remainder == half && (sticky || (rounded & 1)))) {
+            rounded++;
+            if (rounded == (uint64_t) 1 << 53) {
+                rounded >>= 1;
+                shift++;
+            }
+        }
+        return {rounded, exponent + shift};
+    }
+
+
     //From exchange_state.cpp in eosio.system contract source
+    //out = int64_t( (in * ob) / (ib + in) ), computed with doubles by the system contract
+    //
+    //Each of the floating point operations is reproduced exactly with integer arithmetic, including the rounding
+    //of every intermediate result to a double, so that the output is the same as the one of the system contract
+    //without needing (software emulated) floating point math
     int64_t get_bancor_output(
         int64_t inp_reserve,
         int64_t out_reserve,
         int64_t inp
     ) {
-        const double ib = inp_reserve;
-        const double ob = out_reserve;
-        const double in = inp;
-
-        int64_t out = int64_t( (in * ob) / (ib + in) );
-
-        if ( out < 0 ) out = 0;
-
-        return out;
+        //The system contract clamps negative outputs to 0
+        if (inp <= 0 || out_reserve <= 0) {
+            return 0;
+        }
+
+        const exact_double ib = round_to_double(inp_reserve, 0);
+        const exact_double ob = round_to_double(out_reserve, 0);
+        const exact_double in = round_to_double(inp, 0);
+
+        //The exponents of the converted int64 values are at most 11, so the exact results fit into 128 bits
+        exact_double product = round_to_double(
+            (unsigned __int128) in.mantissa * ob.mantissa, in.exponent + ob.exponent);
+        exact_double sum = round_to_double(
+            ((unsigned __int128) ib.mantissa << ib.exponent) + ((unsigned __int128) in.mantissa << in.exponent), 0);
+
+        //Normalizing both mantissas to 53 bits makes the quotient have at least 64 bits before rounding
+        auto normalize = [](exact_double &value) {
+            int shift = __builtin_clzll(value.mantissa) - 11;
+            value.mantissa <<= shift;
+            value.exponent -= shift;
+        };
+        normalize(product);
+        normalize(sum);
+
+        unsigned __int128 dividend = (unsigned __int128) product.mantissa << 64;
+        exact_double quotient = round_to_double(
+            dividend / sum.mantissa, product.exponent - sum.exponent - 64, dividend % sum.mantissa != 0);
+
+        //Conversion to int64_t truncates
+        if (quotient.exponent >= 0) {
+            return (int64_t) (quotient.mantissa << quotient.exponent);
+        }
+        return quotient.exponent <= -64 ? 0 : (int64_t) (quotient.mantissa >> -quotient.exponent);
     }
 
 
@@ -0,0 +1,304 @@
+/*
+
+Pure helpers for the outcomes of pack rolls, shared by the contract and the native tests and tools.
+This file must not depend on the eosio headers, so that it can be compiled natively.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+//Number of bytes used to serialize a vector size (varuint32)
+static constexpr int64_t get_varint_bytes(uint64_t value) {
+    int64_t bytes = 1;
+    for (value >>= 7; value != 0; value >>= 7) {
+        bytes++;
+    }
+    return bytes;
+}
+
+//Appends value as a varint (7 bits per byte, the highest bit being set if more bytes follow)
+inline void write_varint(vector <uint8_t> &bytes, uint64_t value) {
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        bytes.push_back(value != 0 ? byte | 0x80 : byte);
+    } while (value != 0);
+}
+
+//Reads a varint written by write_varint, starting at position, which is advanced past it
+inline uint64_t read_varint(const vector <uint8_t> &bytes, size_t &position) {
+    uint64_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = bytes[position++];
+        value |= (uint64_t) (byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+//Zigzag mapping of signed differences, so that small negative values also have short varints
+inline uint64_t zigzag_encode(int64_t value) {
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t value) {
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+//Formats of the compact outcome encoding of a roll, stored as the first byte of the encoding
+static constexpr uint8_t OUTCOME_ENCODING_SMALL_ODDS = 1; //16 bit odds and 32 bit template ids
+static constexpr uint8_t OUTCOME_ENCODING_DELTA      = 2; //Varint odds and template id differences
+
+struct OUTCOME {
+    uint32_t odds;
+    int32_t  template_id; //-1 is equal to no NFT being minted
+};
+
+struct ALIAS_ENTRY {
+    uint32_t threshold;         //Draws below this threshold select template_id, all others alias_template_id
+    int32_t  template_id;
+    int32_t  alias_template_id;
+};
+
+
+/**
+* Encodes the outcomes of a roll with the smallest compact encoding
+* Returns an empty vector if storing the outcomes as they are is not larger than any of the encodings
+* An encoded roll always stores its count, so count_stored needs to be true if the plain roll would store it as well,
+* in which case the count doesn't count against the encoding
+*
+* Both encodings start with the format byte and the number of outcomes as a varint
+* OUTCOME_ENCODING_SMALL_ODDS stores each outcome as 2 bytes of odds and 4 bytes of template id,
+* and can only be used if all odds fit into 16 bits
+* OUTCOME_ENCODING_DELTA stores the odds of the first outcome as a varint and the odds of each following outcome
+* as the varint difference to the previous odds, which is never negative because the outcomes are sorted
+* in descending order. Each template id is stored as the zigzag varint difference to the previous template id
+*/
+inline vector <uint8_t> encode_outcomes(
+    const vector <OUTCOME> &outcomes,
+    bool count_stored
+) {
+    vector <uint8_t> delta_encoding = {OUTCOME_ENCODING_DELTA};
+    write_varint(delta_encoding, outcomes.size());
+
+    uint32_t previous_odds = 0;
+    int64_t previous_template_id = 0;
+    bool has_small_odds = true;
+
+    for (size_t i = 0; i < outcomes.size(); i++) {
+        write_varint(delta_encoding, i == 0 ? outcomes[i].odds : previous_odds - outcomes[i].odds);
+
+        int64_t template_id_delta = (int64_t) outcomes[i].template_id - previous_template_id;
+        write_varint(delta_encoding, zigzag_encode(template_id_delta));
+
+        previous_odds = outcomes[i].odds;
+        previous_template_id = outcomes[i].template_id;
+        has_small_odds = has_small_odds && outcomes[i].odds <= 0xFFFF;
+    }
+
+    vector <uint8_t> encoding = delta_encoding;
+
+    if (has_small_odds) {
+        vector <uint8_t> small_odds_encoding = {OUTCOME_ENCODING_SMALL_ODDS};
+        write_varint(small_odds_encoding, outcomes.size());
+
+        for (const OUTCOME &outcome : outcomes) {
+            uint16_t odds = outcome.odds;
+            small_odds_encoding.insert(small_odds_encoding.end(), (uint8_t *) &odds, (uint8_t *) &odds + sizeof(odds));
+            small_odds_encoding.insert(small_odds_encoding.end(),
+                (uint8_t *) &outcome.template_id, (uint8_t *) &outcome.template_id + sizeof(outcome.template_id));
+        }
+
+        if (small_odds_encoding.size() < encoding.size()) {
+            encoding = small_odds_encoding;
+        }
+    }
+
+    //The encoded roll still has an empty outcomes vector and needs the count to be set
+    int64_t plain_bytes = get_varint_bytes(outcomes.size()) + outcomes.size() * sizeof(OUTCOME)
+        + (count_stored ? sizeof(uint32_t) : 0);
+    int64_t encoded_bytes = get_varint_bytes(0) + sizeof(uint32_t)
+        + get_varint_bytes(encoding.size()) + encoding.size();
+
+    return encoded_bytes < plain_bytes ? encoding : vector <uint8_t> {};
+}
+
+
+/**
+* Decodes outcomes that were encoded with encode_outcomes
+*/
+inline vector <OUTCOME> decode_outcomes(
+    const vector <uint8_t> &bytes
+) {
+    size_t position = 1;
+
+    vector <OUTCOME> outcomes(read_varint(bytes, position));
+
+    if (bytes[0] == OUTCOME_ENCODING_SMALL_ODDS) {
+        for (OUTCOME &outcome : outcomes) {
+            uint16_t odds;
+            memcpy(&odds, bytes.data() + position, sizeof(odds));
+            position += sizeof(odds);
+            memcpy(&outcome.template_id, bytes.data() + position, sizeof(outcome.template_id));
+            position += sizeof(outcome.template_id);
+            outcome.odds = odds;
+        }
+
+    } else {
+        uint32_t odds = 0;
+        int64_t template_id = 0;
+        for (size_t i = 0; i < outcomes.size(); i++) {
+            odds = i == 0 ? read_varint(bytes, position) : odds - read_varint(bytes, position);
+            template_id += zigzag_decode(read_varint(bytes, position));
+
+            outcomes[i].odds = odds;
+            outcomes[i].template_id = template_id;
+        }
+    }
+
+    return outcomes;
+}
+
+
+/**
+* Builds a Walker / Vose alias table for the outcomes of a roll
+*
+* Each of the n entries represents a column with a capacity of total_odds. Every outcome is scaled by n,
+* and columns with less than total_odds are filled up with the excess of columns with more than total_odds.
+* All calculations are done with integers, so the resulting probabilities are exactly odds / total_odds
+*/
+inline vector <ALIAS_ENTRY> build_alias_table(
+    const vector <OUTCOME> &outcomes,
+    uint32_t total_odds
+) {
+    const uint64_t num_outcomes = outcomes.size();
+
+    vector <ALIAS_ENTRY> entries(num_outcomes);
+    vector <uint64_t> scaled_odds(num_outcomes);
+    vector <uint64_t> small_indices = {};
+    vector <uint64_t> large_indices = {};
+
+    for (uint64_t i = 0; i < num_outcomes; i++) {
+        entries[i].template_id = outcomes[i].template_id;
+        entries[i].alias_template_id = outcomes[i].template_id;
+
+        scaled_odds[i] = (uint64_t) outcomes[i].odds * num_outcomes;
+        if (scaled_odds[i] < total_odds) {
+            small_indices.push_back(i);
+        } else {
+            large_indices.push_back(i);
+        }
+    }
+
+    while (!small_indices.empty() && !large_indices.empty()) {
+        uint64_t small_index = small_indices.back();
+        small_indices.pop_back();
+        uint64_t large_index = large_indices.back();
+
+        entries[small_index].threshold = scaled_odds[small_index];
+        entries[small_index].alias_template_id = outcomes[large_index].template_id;
+
+        scaled_odds[large_index] -= total_odds - scaled_odds[small_index];
+        if (scaled_odds[large_index] < total_odds) {
+            large_indices.pop_back();
+            small_indices.push_back(large_index);
+        }
+    }
+
+    //Because the scaled odds sum up to exactly num_outcomes * total_odds, the remaining columns are full
+    for (uint64_t index : small_indices) {
+        entries[index].threshold = total_odds;
+    }
+    for (uint64_t index : large_indices) {
+        entries[index].threshold = total_odds;
+    }
+
+    return entries;
+}
+
+
+/**
+* Encodes the alias table of a roll, which takes about half the size of the plain entries
+*
+* The encoding starts with the number of entries as a varint. For each entry, total_odds - threshold is stored as a
+* varint, which is 0 for the full columns that make up most of a table, followed by the zigzag varint difference
+* of its template id to the template id of the previous entry. Entries with a threshold below total_odds are
+* followed by the varint index of the entry whose template id is their alias
+*/
+inline vector <uint8_t> encode_alias_table(
+    const vector <ALIAS_ENTRY> &entries,
+    uint32_t total_odds
+) {
+    //The alias is the template id of one of the entries of the table, any entry with that template id can be used
+    map <int32_t, uint64_t> template_indices = {};
+    for (uint64_t i = 0; i < entries.size(); i++) {
+        template_indices.emplace(entries[i].template_id, i);
+    }
+
+    vector <uint8_t> bytes = {};
+    write_varint(bytes, entries.size());
+
+    int64_t previous_template_id = 0;
+    for (const ALIAS_ENTRY &entry : entries) {
+        write_varint(bytes, total_odds - entry.threshold);
+        write_varint(bytes, zigzag_encode((int64_t) entry.template_id - previous_template_id));
+        previous_template_id = entry.template_id;
+
+        if (entry.threshold < total_odds) {
+            write_varint(bytes, template_indices[entry.alias_template_id]);
+        }
+    }
+
+    return bytes;
+}
+
+
+/**
+* Decodes an alias table that was encoded with encode_alias_table
+*/
+inline vector <ALIAS_ENTRY> decode_alias_table(
+    const vector <uint8_t> &bytes,
+    uint32_t total_odds
+) {
+    size_t position = 0;
+    vector <ALIAS_ENTRY> entries(read_varint(bytes, position));
+    vector <uint64_t> alias_indices(entries.size());
+
+    int64_t template_id = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        entries[i].threshold = total_odds - read_varint(bytes, position);
+        template_id += zigzag_decode(read_varint(bytes, position));
+        entries[i].template_id = template_id;
+        alias_indices[i] = entries[i].threshold < total_odds ? read_varint(bytes, position) : i;
+    }
+
+    //Aliases can refer to entries that come after them, so they are only resolved once all template ids are known
+    for (size_t i = 0; i < entries.size(); i++) {
+        entries[i].alias_template_id = entries[alias_indices[i]].template_id;
+    }
+
+    return entries;
+}
+
+
+/**
+* Selects an outcome from the alias table of a roll, rand being a random value in the range [0, entries * total_odds)
+* rand / total_odds selects the entry, and rand % total_odds decides between the entry's template id and its alias
+*/
+inline int32_t get_alias_outcome(
+    const ALIAS_ENTRY *entries,
+    uint32_t total_odds,
+    uint64_t rand
+) {
+    const ALIAS_ENTRY &entry = entries[rand / total_odds];
+    return rand % total_odds < entry.threshold ? entry.template_id : entry.alias_template_id;
+}
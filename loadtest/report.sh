@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+#
+# Prints the cost report of a load test run as markdown, from the transactions.jsonl and config.json that
+# loadtest/run_lifecycle.sh writes to its output directory
+#
+# For each phase of the lifecycle the billed CPU and NET per transaction and the average RAM delta of each account
+# are listed. The billed CPU can't be lower than the node's min_transaction_cpu_usage, so the elapsed time of the
+# transaction is listed as well. Throughput is the rate at which the transactions were pushed one after another
+# with cleos, so it is a lower bound of what the node can process.
+#
+# Usage: loadtest/report.sh <output directory>
+
+set -euo pipefail
+
+OUT_DIR="${1:?Usage: report.sh <output directory>}"
+
+jq -r '"# Load test of \(.commit)\n\n\(.num_packs) packs with \(.num_rolls) rolls of \(.num_templates) outcomes, "
+    + "unbox flags \(.unbox_flags)\n"' "$OUT_DIR/config.json"
+
+jq -s -r '
+    def mean: if length == 0 then 0 else add / length end;
+    def percentile(p): sort | .[((length - 1) * p | floor)];
+
+    . as $transactions
+    | (reduce $transactions[].phase as $phase ([]; if index([$phase]) then . else . + [$phase] end)) as $phases
+    | "| Phase | Transactions | Billed CPU µs (mean / p50 / p95 / max) | Elapsed µs (mean) | NET bytes (mean) "
+        + "| RAM bytes per transaction (mean) | Transactions per second |",
+      "|---|---|---|---|---|---|---|",
+      ($phases[] as $phase
+        | [$transactions[] | select(.phase == $phase)] as $phase_transactions
+        | ($phase_transactions | length) as $count
+        | [$phase_transactions[].cpu_usage_us] as $cpu
+        | ([$phase_transactions[].ram_deltas[]] | group_by(.account)
+            | map("\(.[0].account) \(map(.delta) | add / $count | round)") | join(", ")) as $ram
+        | ($phase_transactions | map(.time) | (max - min)) as $duration
+        | "| \($phase) | \($count) "
+            + "| \($cpu | mean | round) / \($cpu | percentile(0.5)) / \($cpu | percentile(0.95)) / \($cpu | max) "
+            + "| \([$phase_transactions[].elapsed_us] | mean | round) "
+            + "| \([$phase_transactions[].net_usage_bytes] | mean | round) "
+            + "| \(if $ram == "" then "-" else $ram end) "
+            + "| \(if $count > 1 and $duration > 0 then ($count - 1) / $duration | round else "-" end) |")
+' "$OUT_DIR/transactions.jsonl"
@@ -0,0 +1,241 @@
+#!/usr/bin/env bash
+#
+# Runs the full pack lifecycle against a local node and records the billed CPU, NET and RAM of every transaction,
+# so that releases of the contract can be compared by their cost per action (see loadtest/report.sh)
+#
+# NOTE: This harness has not been run against a node yet. The stubs only have been compiled against the native
+# stand-ins of the eosio headers, so expect to fix details of the cleos calls on the first run.
+#
+# Requirements:
+#  - A freshly bootstrapped local nodeos with the http api and the system contracts, where eosio.token has the
+#    core symbol WAX with 8 decimals and eosio holds enough WAX for the stakes and the RAM deposit
+#  - A wallet that is unlocked and holds the private key of eosio and of PUBLIC_KEY
+#  - cdt-cpp (or eosio-cpp, set CDT_CPP) and jq
+#
+# The lifecycle:
+#  1. Creates the accounts, deploys atomicpacks and the stubs of atomicassets and orng.wax (loadtest/stubs)
+#  2. Creates a collection with a pack template and NUM_TEMPLATES outcome templates
+#  3. Deposits DEPOSIT to the collection's RAM balance with the memo deposit_collection_ram:<collection>
+#  4. announcepack, addpackroll NUM_ROLLS times, completepack with UNBOX_FLAGS
+#  5. Mints NUM_PACKS pack assets to the unboxer and opens each with a transfer with the memo unbox
+#  6. Answers every randomness request, which sends receiverand
+#  7. Claims the results of each pack with claimunboxed (not for packs with direct minting)
+#
+# Written to OUT_DIR:
+#  transactions.jsonl  one line per measured transaction with its phase, billed CPU, NET and RAM deltas
+#  actions.jsonl       all action traces, which can be folded with native/build/index_traces
+#  report.md           the report of loadtest/report.sh
+
+set -euo pipefail
+
+REPO_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+
+CLEOS="${CLEOS:-cleos}"
+NODE_URL="${NODE_URL:-http://127.0.0.1:8888}"
+CDT_CPP="${CDT_CPP:-cdt-cpp}"
+PUBLIC_KEY="${PUBLIC_KEY:?PUBLIC_KEY needs to be set to a key of the unlocked wallet}"
+
+NUM_ROLLS="${NUM_ROLLS:-10}"
+NUM_TEMPLATES="${NUM_TEMPLATES:-4}"
+NUM_PACKS="${NUM_PACKS:-2000}"
+UNBOX_FLAGS="${UNBOX_FLAGS:-0}"
+DEPOSIT="${DEPOSIT:-10000.00000000 WAX}"
+STAKE="${STAKE:-1000.00000000 WAX}"
+OUT_DIR="${OUT_DIR:-$REPO_DIR/loadtest/out}"
+
+BUILD_DIR="$OUT_DIR/build"
+COLLECTION_NAME="loadtestcol"
+AUTHOR="packauthor"
+UNBOXER="packunboxer"
+
+#Opening a pack with more rolls is split into unbox steps, which are not scripted here
+if (( NUM_ROLLS > 200 )); then
+    echo "NUM_ROLLS can be at most 200" >&2
+    exit 1
+fi
+
+mkdir -p "$BUILD_DIR"
+rm -f "$OUT_DIR/transactions.jsonl" "$OUT_DIR/actions.jsonl"
+
+cleos() {
+    command "$CLEOS" -u "$NODE_URL" "$@"
+}
+
+
+# Pushes a single action and records the transaction under the given phase
+# Usage: push_action <phase> <account> <action> <data> <authorization>
+push_action() {
+    local phase="$1"
+    local output
+    if ! output="$(cleos push action "$2" "$3" "$4" -p "$5" -j 2>&1)"; then
+        echo "$phase: $3 failed" >&2
+        echo "$output" >&2
+        exit 1
+    fi
+
+    jq -c --arg phase "$phase" --arg time "$(date +%s.%N)" '{
+        phase: $phase,
+        time: ($time | tonumber),
+        cpu_usage_us: .processed.receipt.cpu_usage_us,
+        net_usage_bytes: (.processed.receipt.net_usage_words * 8),
+        elapsed_us: .processed.elapsed,
+        ram_deltas: [.processed.action_traces[].account_ram_deltas[]?]
+    }' <<< "$output" >> "$OUT_DIR/transactions.jsonl"
+    jq -c '.processed.action_traces[]' <<< "$output" >> "$OUT_DIR/actions.jsonl"
+
+    LAST_OUTPUT="$output"
+}
+
+# Pushes an action that is only part of the setup, with force-unique so that identical actions can be repeated
+setup_action() {
+    local output
+    if ! output="$(cleos push action "$1" "$2" "$3" -p "$4" -f -j 2>&1)"; then
+        echo "setup: $2 failed" >&2
+        echo "$output" >&2
+        exit 1
+    fi
+}
+
+create_account() {
+    local creator="$1"
+    local account="$2"
+    local ram_kbytes="$3"
+    cleos system newaccount "$creator" "$account" "$PUBLIC_KEY" "$PUBLIC_KEY" \
+        --stake-net "$STAKE" --stake-cpu "$STAKE" --buy-ram-kbytes "$ram_kbytes" --transfer > /dev/null
+}
+
+build_contract() {
+    local contract_name="$1"
+    local source="$2"
+    mkdir -p "$BUILD_DIR/$contract_name"
+    "$CDT_CPP" -abigen -I "$REPO_DIR/include" -contract "$contract_name" \
+        -o "$BUILD_DIR/$contract_name/$contract_name.wasm" "$source"
+}
+
+deploy_contract() {
+    local account="$1"
+    local contract_name="$2"
+    cleos set contract "$account" "$BUILD_DIR/$contract_name" \
+        "$contract_name.wasm" "$contract_name.abi" > /dev/null
+    cleos set account permission "$account" active --add-code > /dev/null
+}
+
+# Prints the rows of a table as a JSON array, following the more flag of get table
+get_rows() {
+    local code="$1"
+    local scope="$2"
+    local table="$3"
+    local lower_bound=""
+    local rows="[]"
+    while true; do
+        local page
+        page="$(cleos get table "$code" "$scope" "$table" --limit 1000 ${lower_bound:+--lower "$lower_bound"})"
+        rows="$(jq -c --argjson rows "$rows" '$rows + .rows' <<< "$page")"
+        if [[ "$(jq -r '.more' <<< "$page")" == "false" ]]; then
+            break
+        fi
+        lower_bound="$(jq -r '.next_key' <<< "$page")"
+    done
+    echo "$rows"
+}
+
+
+echo "Building the contracts"
+build_contract atomicpacks "$REPO_DIR/src/atomicpacks.cpp"
+build_contract stubassets "$REPO_DIR/loadtest/stubs/stubassets.cpp"
+build_contract stuborng "$REPO_DIR/loadtest/stubs/stuborng.cpp"
+
+echo "Creating the accounts"
+create_account eosio atomicpacks 4096
+create_account eosio atomicassets 1024
+create_account eosio wax 64
+#orng.wax can only be created by wax
+cleos transfer eosio wax "$DEPOSIT" > /dev/null
+create_account wax orng.wax 1024
+#The author pays for the minted packs and the unboxer for moving them to atomicpacks, about 150 bytes each
+create_account eosio "$AUTHOR" $(( NUM_PACKS / 4 + 1024 ))
+create_account eosio "$UNBOXER" $(( NUM_PACKS / 4 + 64 ))
+cleos transfer eosio "$AUTHOR" "$DEPOSIT" > /dev/null
+
+deploy_contract atomicpacks atomicpacks
+deploy_contract atomicassets stubassets
+deploy_contract orng.wax stuborng
+
+echo "Creating the collection"
+setup_action atomicassets createcol "[\"$AUTHOR\", \"$COLLECTION_NAME\", [\"$AUTHOR\", \"atomicpacks\"]]" "$AUTHOR"
+setup_action atomicassets createtempl "[\"$AUTHOR\", \"$COLLECTION_NAME\", \"packs\", true, true, 0]" "$AUTHOR"
+for (( i = 0; i < NUM_TEMPLATES; i++ )); do
+    setup_action atomicassets createtempl "[\"$AUTHOR\", \"$COLLECTION_NAME\", \"cards\", true, true, 0]" "$AUTHOR"
+done
+
+TEMPLATE_IDS=($(get_rows atomicassets "$COLLECTION_NAME" templates | jq -r '.[].template_id'))
+PACK_TEMPLATE_ID="${TEMPLATE_IDS[0]}"
+OUTCOME_TEMPLATE_IDS=("${TEMPLATE_IDS[@]:1}")
+
+
+echo "Setting up the pack"
+push_action deposit eosio.token transfer \
+    "[\"$AUTHOR\", \"atomicpacks\", \"$DEPOSIT\", \"deposit_collection_ram:$COLLECTION_NAME\"]" "$AUTHOR"
+
+push_action announcepack atomicpacks announcepack "[\"$AUTHOR\", \"$COLLECTION_NAME\", 0, \"\"]" "$AUTHOR"
+PACK_ID="$(jq -r '.processed.action_traces[] | select(.act.name == "lognewpack") | .act.data.pack_id' \
+    <<< "$LAST_OUTPUT" | head -n 1)"
+
+for (( i = 0; i < NUM_ROLLS; i++ )); do
+    #The odds differ between the rolls, so that the transactions are not identical
+    outcomes="[]"
+    total_odds=0
+    for (( j = 0; j < NUM_TEMPLATES; j++ )); do
+        odds=$(( (NUM_TEMPLATES - j) * 100 + i ))
+        total_odds=$(( total_odds + odds ))
+        outcomes="$(jq -c --argjson odds "$odds" --argjson template_id "${OUTCOME_TEMPLATE_IDS[$j]}" \
+            '. + [{odds: $odds, template_id: $template_id}]' <<< "$outcomes")"
+    done
+    push_action addpackroll atomicpacks addpackroll \
+        "[\"$AUTHOR\", $PACK_ID, $outcomes, $total_odds, 1]" "$AUTHOR"
+done
+
+push_action completepack atomicpacks completepack \
+    "[\"$AUTHOR\", $PACK_ID, $PACK_TEMPLATE_ID, $UNBOX_FLAGS]" "$AUTHOR"
+
+
+echo "Minting $NUM_PACKS packs"
+for (( i = 0; i < NUM_PACKS; i++ )); do
+    setup_action atomicassets mintasset \
+        "[\"$AUTHOR\", \"$COLLECTION_NAME\", \"packs\", $PACK_TEMPLATE_ID, \"$UNBOXER\", [], [], []]" "$AUTHOR"
+done
+
+PACK_ASSET_IDS=($(get_rows atomicassets "$UNBOXER" assets \
+    | jq -r --argjson template_id "$PACK_TEMPLATE_ID" '.[] | select(.template_id == $template_id) | .asset_id'))
+
+
+echo "Opening ${#PACK_ASSET_IDS[@]} packs"
+for asset_id in "${PACK_ASSET_IDS[@]}"; do
+    push_action unbox atomicassets transfer "[\"$UNBOXER\", \"atomicpacks\", [$asset_id], \"unbox\"]" "$UNBOXER"
+done
+
+echo "Answering the randomness requests"
+for job_id in $(get_rows orng.wax orng.wax jobs | jq -r '.[].id'); do
+    push_action receiverand orng.wax answer "[$job_id]" orng.wax
+done
+
+if (( (UNBOX_FLAGS & 1) == 0 )); then
+    echo "Claiming the results"
+    ROLL_IDS="$(jq -c -n --argjson num_rolls "$NUM_ROLLS" '[range(0; $num_rolls)]')"
+    for asset_id in "${PACK_ASSET_IDS[@]}"; do
+        push_action claimunboxed atomicpacks claimunboxed "[$asset_id, $ROLL_IDS]" "$UNBOXER"
+    done
+fi
+
+
+jq -n \
+    --arg commit "$(git -C "$REPO_DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)" \
+    --argjson num_rolls "$NUM_ROLLS" \
+    --argjson num_templates "$NUM_TEMPLATES" \
+    --argjson num_packs "$NUM_PACKS" \
+    --argjson unbox_flags "$UNBOX_FLAGS" \
+    '{commit: $commit, num_rolls: $num_rolls, num_templates: $num_templates, num_packs: $num_packs,
+      unbox_flags: $unbox_flags}' > "$OUT_DIR/config.json"
+
+"$REPO_DIR/loadtest/report.sh" "$OUT_DIR" > "$OUT_DIR/report.md"
+echo "Report written to $OUT_DIR/report.md"
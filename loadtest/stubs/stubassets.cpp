@@ -0,0 +1,250 @@
+/*
+
+Stand-in for the atomicassets contract, only used by the load test on a local node (see loadtest/run_lifecycle.sh)
+
+The collections, templates and assets are stored in the same layout as in atomicassets, so that atomicpacks reads
+them exactly like on chain. Everything atomicpacks doesn't depend on is left out: There are no schemas, the
+attributes of templates and assets are not serialized, and there are no offers, backed tokens, log actions
+or notifications to the collection's notify accounts.
+The RAM of templates and assets is paid by the same accounts as in atomicassets, so that the RAM deltas measured
+with this contract match the ones on chain.
+
+*/
+
+#include <atomicassets-interface.hpp>
+
+
+CONTRACT stubassets : public contract {
+public:
+    using contract::contract;
+
+    ACTION createcol(
+        name author,
+        name collection_name,
+        vector <name> authorized_accounts
+    );
+
+    ACTION createtempl(
+        name authorized_creator,
+        name collection_name,
+        name schema_name,
+        bool transferable,
+        bool burnable,
+        uint32_t max_supply
+    );
+
+    ACTION mintasset(
+        name authorized_minter,
+        name collection_name,
+        name schema_name,
+        int32_t template_id,
+        name new_asset_owner,
+        atomicassets::ATTRIBUTE_MAP immutable_data,
+        atomicassets::ATTRIBUTE_MAP mutable_data,
+        vector <asset> tokens_to_back
+    );
+
+    ACTION burnasset(
+        name asset_owner,
+        uint64_t asset_id
+    );
+
+    ACTION transfer(
+        name from,
+        name to,
+        vector <uint64_t> asset_ids,
+        string memo
+    );
+
+private:
+    void check_has_collection_auth(name account_to_check, name collection_name);
+};
+
+
+/**
+* Creates a collection without any data, which allows notifications like every collection that atomicpacks is used with
+*
+* @required_auth author
+*/
+ACTION stubassets::createcol(
+    name author,
+    name collection_name,
+    vector <name> authorized_accounts
+) {
+    require_auth(author);
+
+    check(atomicassets::collections.find(collection_name.value) == atomicassets::collections.end(),
+        "A collection with this name already exists");
+
+    atomicassets::collections.emplace(author, [&](auto &_collection) {
+        _collection.collection_name = collection_name;
+        _collection.author = author;
+        _collection.allow_notify = true;
+        _collection.authorized_accounts = authorized_accounts;
+        _collection.notify_accounts = {};
+        _collection.market_fee = 0;
+        _collection.serialized_data = {};
+    });
+}
+
+
+/**
+* Creates a template without immutable data, with the next template id of the config singleton
+*
+* @required_auth authorized_creator, who must be authorized within the collection
+*/
+ACTION stubassets::createtempl(
+    name authorized_creator,
+    name collection_name,
+    name schema_name,
+    bool transferable,
+    bool burnable,
+    uint32_t max_supply
+) {
+    require_auth(authorized_creator);
+    check_has_collection_auth(authorized_creator, collection_name);
+
+    atomicassets::config_s current_config = atomicassets::config.get_or_default();
+    int32_t template_id = current_config.template_counter++;
+    atomicassets::config.set(current_config, get_self());
+
+    atomicassets::get_templates(collection_name).emplace(authorized_creator, [&](auto &_template) {
+        _template.template_id = template_id;
+        _template.schema_name = schema_name;
+        _template.transferable = transferable;
+        _template.burnable = burnable;
+        _template.max_supply = max_supply;
+        _template.issued_supply = 0;
+        _template.immutable_serialized_data = {};
+    });
+}
+
+
+/**
+* Mints an asset of a template, paid by the minter
+* The attributes and tokens to back are ignored, atomicpacks always sends them empty
+*
+* @required_auth authorized_minter, who must be authorized within the collection
+*/
+ACTION stubassets::mintasset(
+    name authorized_minter,
+    name collection_name,
+    name schema_name,
+    int32_t template_id,
+    name new_asset_owner,
+    atomicassets::ATTRIBUTE_MAP immutable_data,
+    atomicassets::ATTRIBUTE_MAP mutable_data,
+    vector <asset> tokens_to_back
+) {
+    require_auth(authorized_minter);
+    check_has_collection_auth(authorized_minter, collection_name);
+
+    atomicassets::templates_t col_templates = atomicassets::get_templates(collection_name);
+    auto template_itr = col_templates.require_find((uint64_t) template_id,
+        "No template with this id exists within the collection");
+    check(template_itr->schema_name == schema_name, "The template belongs to another schema");
+    check(template_itr->max_supply == 0 || template_itr->issued_supply < template_itr->max_supply,
+        "The template's maxsupply has already been reached");
+
+    col_templates.modify(template_itr, same_payer, [&](auto &_template) {
+        _template.issued_supply++;
+    });
+
+    atomicassets::config_s current_config = atomicassets::config.get_or_default();
+    uint64_t asset_id = current_config.asset_counter++;
+    atomicassets::config.set(current_config, get_self());
+
+    atomicassets::get_assets(new_asset_owner).emplace(authorized_minter, [&](auto &_asset) {
+        _asset.asset_id = asset_id;
+        _asset.collection_name = collection_name;
+        _asset.schema_name = schema_name;
+        _asset.template_id = template_id;
+        _asset.ram_payer = authorized_minter;
+        _asset.backed_tokens = {};
+        _asset.immutable_serialized_data = {};
+        _asset.mutable_serialized_data = {};
+    });
+}
+
+
+/**
+* Burns an asset of a burnable template
+*
+* @required_auth asset_owner
+*/
+ACTION stubassets::burnasset(
+    name asset_owner,
+    uint64_t asset_id
+) {
+    require_auth(asset_owner);
+
+    atomicassets::assets_t owner_assets = atomicassets::get_assets(asset_owner);
+    auto asset_itr = owner_assets.require_find(asset_id, "No asset with this id exists");
+
+    if (asset_itr->template_id != -1) {
+        atomicassets::templates_t col_templates = atomicassets::get_templates(asset_itr->collection_name);
+        check(col_templates.get((uint64_t) asset_itr->template_id).burnable, "The asset is not burnable");
+    }
+
+    owner_assets.erase(asset_itr);
+}
+
+
+/**
+* Transfers assets and notifies both sides, which is how packs are opened
+* Like in atomicassets, the moved asset rows are paid by the sender
+*
+* @required_auth from
+*/
+ACTION stubassets::transfer(
+    name from,
+    name to,
+    vector <uint64_t> asset_ids,
+    string memo
+) {
+    require_auth(from);
+
+    check(is_account(to), "to account does not exist");
+    check(from != to, "Can't transfer assets to yourself");
+    check(asset_ids.size() != 0, "asset_ids needs to contain at least one id");
+    check(memo.length() <= 256, "A transfer memo can only be 256 characters max");
+
+    atomicassets::assets_t from_assets = atomicassets::get_assets(from);
+    atomicassets::assets_t to_assets = atomicassets::get_assets(to);
+
+    for (uint64_t asset_id : asset_ids) {
+        auto asset_itr = from_assets.require_find(asset_id,
+            ("Sender doesn't own at least one of the provided assets (ID: " + to_string(asset_id) + ")").c_str());
+
+        if (asset_itr->template_id != -1) {
+            atomicassets::templates_t col_templates = atomicassets::get_templates(asset_itr->collection_name);
+            check(col_templates.get((uint64_t) asset_itr->template_id).transferable,
+                "At least one asset isn't transferable (ID: " + to_string(asset_id) + ")");
+        }
+
+        atomicassets::assets_s moved_asset = *asset_itr;
+        from_assets.erase(asset_itr);
+        to_assets.emplace(from, [&](auto &_asset) {
+            _asset = moved_asset;
+        });
+    }
+
+    require_recipient(from);
+    require_recipient(to);
+}
+
+
+void stubassets::check_has_collection_auth(
+    name account_to_check,
+    name collection_name
+) {
+    auto collection_itr = atomicassets::collections.require_find(collection_name.value,
+        "No collection with this name exists");
+
+    check(std::find(
+        collection_itr->authorized_accounts.begin(),
+        collection_itr->authorized_accounts.end(),
+        account_to_check
+        ) != collection_itr->authorized_accounts.end(),
+        "The account " + account_to_check.to_string() + " is not authorized within the collection");
+}
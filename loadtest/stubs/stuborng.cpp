@@ -0,0 +1,107 @@
+/*
+
+Stand-in for the WAX RNG oracle (orng.wax), only used by the load test on a local node
+(see loadtest/run_lifecycle.sh)
+
+requestrand stores the signing value and a job like the oracle, paid by the caller. Instead of the oracle's
+signed random values, each job is answered with the answer action, which sends receiverand with a value hashed from
+the job, so that the randomness is received in a separate transaction like on chain.
+
+*/
+
+#include <eosio/crypto.hpp>
+#include <eosio/transaction.hpp>
+
+#include <wax-orng-interface.hpp>
+
+using namespace std;
+
+
+CONTRACT stuborng : public contract {
+public:
+    using contract::contract;
+
+    ACTION requestrand(
+        uint64_t assoc_id,
+        uint64_t signing_value,
+        name caller
+    );
+
+    ACTION answer(
+        uint64_t job_id
+    );
+
+private:
+    TABLE jobs_s {
+        uint64_t id;
+        uint64_t assoc_id;
+        uint64_t signing_value;
+        name     caller;
+
+        uint64_t primary_key() const { return id; }
+    };
+    typedef multi_index <name("jobs"), jobs_s> jobs_t;
+
+    jobs_t jobs = jobs_t(get_self(), get_self().value);
+};
+
+
+/**
+* Stores a randomness request, which is answered later with the answer action
+* Signing values can only be used once, like in the oracle
+*
+* @required_auth caller
+*/
+ACTION stuborng::requestrand(
+    uint64_t assoc_id,
+    uint64_t signing_value,
+    name caller
+) {
+    require_auth(caller);
+
+    check(orng::signvals.find(signing_value) == orng::signvals.end(), "Signing value already used");
+    orng::signvals.emplace(caller, [&](auto &_signval) {
+        _signval.signing_value = signing_value;
+    });
+
+    jobs.emplace(caller, [&](auto &_job) {
+        _job.id = jobs.available_primary_key();
+        _job.assoc_id = assoc_id;
+        _job.signing_value = signing_value;
+        _job.caller = caller;
+    });
+}
+
+
+/**
+* Sends receiverand to the caller of a job and erases it, which refunds the job's RAM to the caller
+* The random value is the sha256 hash of the job id, the signing value and the tapos block prefix
+*
+* @required_auth The contract itself
+*/
+ACTION stuborng::answer(
+    uint64_t job_id
+) {
+    require_auth(get_self());
+
+    auto job_itr = jobs.require_find(job_id, "No job with this id exists");
+
+    vector <char> seed_data = eosio::pack(std::make_tuple(
+        job_itr->id,
+        job_itr->signing_value,
+        tapos_block_prefix()
+    ));
+    checksum256 random_value = sha256(seed_data.data(), seed_data.size());
+
+    action(
+        permission_level{get_self(), name("active")},
+        job_itr->caller,
+        name("receiverand"),
+        std::make_tuple(
+            job_itr->assoc_id,
+            random_value
+        )
+    ).send();
+
+    jobs.erase(job_itr);
+}
@@ -0,0 +1,80 @@
+/*
+
+Compares selecting an outcome with the alias table of a roll against the linear scan over the summed odds
+that was used before alias tables were introduced, for rolls with 10, 100 and 1000 outcomes.
+The random values are drawn beforehand, so that only the selection itself is measured.
+
+*/
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <roll-outcomes.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+
+
+static const size_t NUM_RANDS = 4096;
+
+
+//The selection of the contract before alias tables, rand being in the range [0, total_odds)
+static int32_t get_linear_outcome(const vector <OUTCOME> &outcomes, uint32_t rand) {
+    uint32_t summed_odds = 0;
+    for (const OUTCOME &outcome : outcomes) {
+        summed_odds += outcome.odds;
+        if (summed_odds > rand) {
+            return outcome.template_id;
+        }
+    }
+    return -1;
+}
+
+
+static void bench_outcomes(mt19937_64 &generator, size_t num_outcomes) {
+    vector <OUTCOME> outcomes(num_outcomes);
+    uint32_t total_odds = 0;
+    for (size_t i = 0; i < num_outcomes; i++) {
+        outcomes[i] = {(uint32_t) (generator() % 1000 + 1), (int32_t) i};
+        total_odds += outcomes[i].odds;
+    }
+    vector <ALIAS_ENTRY> entries = build_alias_table(outcomes, total_odds);
+
+    vector <uint32_t> linear_rands(NUM_RANDS);
+    vector <uint64_t> alias_rands(NUM_RANDS);
+    for (size_t i = 0; i < NUM_RANDS; i++) {
+        linear_rands[i] = generator() % total_odds;
+        alias_rands[i] = generator() % (entries.size() * (uint64_t) total_odds);
+    }
+
+    string linear_name = "linear scan, " + to_string(num_outcomes) + " outcomes";
+    double linear_ns = run_benchmark(linear_name.c_str(), NUM_RANDS, [&]() {
+        uint64_t sum = 0;
+        for (uint32_t rand : linear_rands) {
+            sum += get_linear_outcome(outcomes, rand);
+        }
+        benchmark_sink = benchmark_sink + sum;
+    });
+
+    string alias_name = "alias table, " + to_string(num_outcomes) + " outcomes";
+    double alias_ns = run_benchmark(alias_name.c_str(), NUM_RANDS, [&]() {
+        uint64_t sum = 0;
+        for (uint64_t rand : alias_rands) {
+            sum += get_alias_outcome(entries.data(), total_odds, rand);
+        }
+        benchmark_sink = benchmark_sink + sum;
+    });
+
+    printf("%-48s %12.2fx\n\n", "speedup", linear_ns / alias_ns);
+}
+
+
+int main() {
+    mt19937_64 generator(1);
+    for (size_t num_outcomes : {10, 100, 1000}) {
+        bench_outcomes(generator, num_outcomes);
+    }
+    return 0;
+}
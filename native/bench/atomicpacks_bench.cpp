@@ -0,0 +1,163 @@
+/*
+
+Measures the CPU time of the contract actions that run per opened pack or per roll, natively against the
+stand-in for the chain (see tests/atomicpacks_harness.hpp)
+
+The times include the stand-in's table access and serialization and the fakes of atomicassets and the rng oracle,
+which are not the costs on chain. They are meant to compare versions of the contract on the same machine,
+not to predict the CPU time billed on chain.
+
+*/
+
+#include "../tests/atomicpacks_harness.hpp"
+
+#include "bench.hpp"
+
+using namespace harness;
+
+
+static constexpr name UNBOXER = name("unboxer");
+
+static constexpr int64_t COLLECTION_RAM_BYTES = 1000000000000;
+
+//The chain is set up again after this many opened packs, so that the tables don't keep growing
+static constexpr uint64_t PACKS_PER_SETUP = 2000;
+
+
+static vector <OUTCOME> make_outcomes(uint32_t num_outcomes) {
+    vector <OUTCOME> outcomes = {};
+    for (uint32_t i = 0; i < num_outcomes; i++) {
+        outcomes.push_back({
+            .odds = num_outcomes - i,
+            .template_id = i % 4 == 3 ? -1 : FIRST_OUTCOME_TEMPLATE_ID + (int32_t) (i % NUM_OUTCOME_TEMPLATES)
+        });
+    }
+    return outcomes;
+}
+
+static uint32_t get_total_odds(const vector <OUTCOME> &outcomes) {
+    uint32_t total_odds = 0;
+    for (const OUTCOME &outcome : outcomes) {
+        total_odds += outcome.odds;
+    }
+    return total_odds;
+}
+
+static vector <atomicpacks::ROLL_DATA> make_rolls(uint32_t num_rolls, uint32_t count) {
+    vector <OUTCOME> outcomes = make_outcomes(8);
+    vector <atomicpacks::ROLL_DATA> rolls = {};
+    for (uint32_t i = 0; i < num_rolls; i++) {
+        rolls.push_back({.outcomes = outcomes, .total_odds = get_total_odds(outcomes), .count = count});
+    }
+    return rolls;
+}
+
+
+/**
+* Opens packs of a single pack definition, setting up the chain again when needed
+*/
+class PACK_OPENER {
+public:
+    PACK_OPENER(const vector <atomicpacks::ROLL_DATA> &rolls, uint32_t unbox_flags) :
+        rolls(rolls), unbox_flags(unbox_flags) {}
+
+    OPENED_PACKS open(uint32_t num_packs) {
+        if (opened_packs == 0 || opened_packs >= PACKS_PER_SETUP) {
+            setup_chain(COLLECTION_RAM_BYTES);
+            pack = create_pack(rolls, unbox_flags);
+            opened_packs = 0;
+        }
+        opened_packs += num_packs;
+
+        OPENED_PACKS opened = open_packs(pack, num_packs, UNBOXER);
+        require_success(opened.result, "opening packs");
+        return opened;
+    }
+
+    OPENED_PACKS open_and_receive(uint32_t num_packs) {
+        OPENED_PACKS opened = open(num_packs);
+        require_success(deliver_randomness(opened.pack_asset_ids[0], make_random_value(random_counter++)),
+            "receiverand");
+        return opened;
+    }
+
+private:
+    vector <atomicpacks::ROLL_DATA> rolls;
+    uint32_t                        unbox_flags;
+    TEST_PACK                       pack = {};
+    uint64_t                        opened_packs = 0;
+    uint64_t                        random_counter = 0;
+};
+
+
+static void bench_receiverand(
+    const char *benchmark_name,
+    uint32_t num_rolls,
+    uint32_t num_packs,
+    uint32_t unbox_flags
+) {
+    PACK_OPENER opener(make_rolls(num_rolls, 1), unbox_flags);
+    OPENED_PACKS opened;
+    uint64_t random_counter = 0;
+
+    run_prepared_benchmark(benchmark_name, 1, [&]() {
+        opened = opener.open(num_packs);
+    }, [&]() {
+        require_success(deliver_randomness(opened.pack_asset_ids[0], make_random_value(random_counter++)),
+            "receiverand");
+    });
+}
+
+static void bench_claimunboxed(const char *benchmark_name, uint32_t num_rolls, uint32_t unbox_flags) {
+    PACK_OPENER opener(make_rolls(num_rolls, 1), unbox_flags);
+    OPENED_PACKS opened;
+    vector <uint64_t> roll_ids = {};
+    for (uint64_t roll_id = 0; roll_id < num_rolls; roll_id++) {
+        roll_ids.push_back(roll_id);
+    }
+
+    run_prepared_benchmark(benchmark_name, 1, [&]() {
+        opened = opener.open_and_receive(1);
+    }, [&]() {
+        require_success(run_action({UNBOXER}, [&](atomicpacks &contract) {
+            contract.claimunboxed(opened.pack_asset_ids[0], roll_ids);
+        }), "claimunboxed");
+    });
+}
+
+static void bench_addpackroll(const char *benchmark_name, uint32_t num_outcomes) {
+    setup_chain(COLLECTION_RAM_BYTES);
+    uint64_t pack_id = announce_pack();
+
+    vector <OUTCOME> outcomes = make_outcomes(num_outcomes);
+    uint32_t total_odds = get_total_odds(outcomes);
+
+    run_benchmark(benchmark_name, 1, [&]() {
+        require_success(run_action({AUTHOR}, [&](atomicpacks &contract) {
+            contract.addpackroll(AUTHOR, pack_id, outcomes, total_odds, binary_extension <uint32_t> ());
+        }), "addpackroll");
+    });
+}
+
+
+int main() {
+    //Failing actions are not expected, so the chain state is not copied to be able to revert them
+    harness_state().revert_on_failure = false;
+
+    bench_receiverand("receiverand, 10 rolls", 10, 1, 0);
+    bench_receiverand("receiverand, 10 rolls, direct mint", 10, 1, UNBOX_FLAG_DIRECT_MINT);
+    bench_receiverand("receiverand, 10 rolls, packed results", 10, 1, UNBOX_FLAG_PACKED_RESULTS);
+    bench_receiverand("receiverand, 10 rolls, deferred results", 10, 1, UNBOX_FLAG_DEFERRED_RESULTS);
+    bench_receiverand("receiverand, 200 rolls", 200, 1, 0);
+    bench_receiverand("receiverand, 200 rolls, packed results", 200, 1, UNBOX_FLAG_PACKED_RESULTS);
+    bench_receiverand("receiverand, 10 packs of 10 rolls", 10, 10, 0);
+
+    bench_claimunboxed("claimunboxed, 10 rolls", 10, 0);
+    bench_claimunboxed("claimunboxed, 10 rolls, packed results", 10, UNBOX_FLAG_PACKED_RESULTS);
+    bench_claimunboxed("claimunboxed, 10 rolls, deferred results", 10, UNBOX_FLAG_DEFERRED_RESULTS);
+
+    bench_addpackroll("addpackroll, 4 outcomes", 4);
+    bench_addpackroll("addpackroll, 32 outcomes", 32);
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+
+Compares the CPU time of the integer bancor math in ram-interface.hpp with the double formula it replaced
+
+Contract WASM runs floating point operations through softfloat, so the double formula is much slower on chain
+than natively. There is no software double implementation on the native targets, so the __float128 version
+(emulated by libgcc) stands in for softfloat: it is a proxy for the cost on chain, not a measurement of it.
+
+*/
+
+#include <random>
+#include <vector>
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+
+#include <ram-interface.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+
+
+static const size_t NUM_QUOTES = 4096;
+
+
+struct QUOTE_INPUT {
+    int64_t inp_reserve;
+    int64_t out_reserve;
+    int64_t inp;
+};
+
+
+//From exchange_state.cpp in eosio.system contract source, with the floating point type as a parameter
+template <typename FLOAT>
+static int64_t get_bancor_output_float(int64_t inp_reserve, int64_t out_reserve, int64_t inp) {
+    const FLOAT ib = inp_reserve;
+    const FLOAT ob = out_reserve;
+    const FLOAT in = inp;
+
+    int64_t out = int64_t( (in * ob) / (ib + in) );
+
+    if ( out < 0 ) out = 0;
+
+    return out;
+}
+
+
+template <typename QUOTE>
+static void bench_quotes(const char *name, const vector <QUOTE_INPUT> &inputs, QUOTE &&quote) {
+    run_benchmark(name, inputs.size(), [&]() {
+        int64_t sum = 0;
+        for (const QUOTE_INPUT &input : inputs) {
+            sum += quote(input.inp_reserve, input.out_reserve, input.inp);
+        }
+        benchmark_sink = benchmark_sink + sum;
+    });
+}
+
+
+int main() {
+    //Values close to the ones of the WAX RAM market, both for buying and for selling RAM
+    mt19937_64 generator(1);
+    vector <QUOTE_INPUT> inputs(NUM_QUOTES);
+    for (size_t i = 0; i < NUM_QUOTES; i++) {
+        int64_t ram_reserve = 100000000000ll + generator() % 400000000000ll;
+        int64_t core_reserve = 1000000000000000ll + generator() % 40000000000000000ll;
+        if (i % 2 == 0) {
+            inputs[i] = {core_reserve, ram_reserve, (int64_t) (generator() % 100000000000000ll)};
+        } else {
+            inputs[i] = {ram_reserve, core_reserve, (int64_t) (generator() % 10000000000ll)};
+        }
+    }
+
+    bench_quotes("integer (ram::get_bancor_output)", inputs, ram::get_bancor_output);
+    bench_quotes("double, hardware", inputs, get_bancor_output_float <double>);
+    bench_quotes("__float128, software (softfloat proxy)", inputs, get_bancor_output_float <__float128>);
+
+    return 0;
+}
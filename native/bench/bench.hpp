@@ -0,0 +1,73 @@
+/*
+
+Minimal helpers shared by the native benchmarks. Each benchmark is a separate executable that prints
+the time per operation of each of its cases. The numbers are only comparable on the same machine.
+
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+//Keeps the compiler from removing computations whose results are otherwise unused
+static volatile uint64_t benchmark_sink = 0;
+
+
+inline double print_benchmark(const char *name, double nanoseconds) {
+    printf("%-48s %12.2f ns/op %14.0f op/s\n", name, nanoseconds, 1e9 / nanoseconds);
+    return nanoseconds;
+}
+
+
+/**
+* Runs the operation until at least min_seconds have passed and prints the average time per operation
+* Each call of the operation performs operations_per_call operations
+* Returns the average time per operation in nanoseconds
+*/
+template <typename OPERATION>
+double run_benchmark(const char *name, uint64_t operations_per_call, OPERATION &&operation, double min_seconds = 0.5) {
+    using clock = std::chrono::steady_clock;
+
+    uint64_t calls = 0;
+    clock::time_point start = clock::now();
+    double elapsed = 0;
+    do {
+        for (int i = 0; i < 16; i++) {
+            operation();
+        }
+        calls += 16;
+        elapsed = std::chrono::duration <double> (clock::now() - start).count();
+    } while (elapsed < min_seconds);
+
+    return print_benchmark(name, elapsed * 1e9 / (calls * operations_per_call));
+}
+
+
+/**
+* Like run_benchmark, for operations that need a fresh state for each call, like opened packs for receiverand
+* prepare is called before each call of the operation and is not part of the measured time
+*/
+template <typename PREPARE, typename OPERATION>
+double run_prepared_benchmark(
+    const char *name,
+    uint64_t operations_per_call,
+    PREPARE &&prepare,
+    OPERATION &&operation,
+    double min_seconds = 0.5
+) {
+    using clock = std::chrono::steady_clock;
+
+    uint64_t calls = 0;
+    double elapsed = 0;
+    do {
+        prepare();
+        clock::time_point start = clock::now();
+        operation();
+        elapsed += std::chrono::duration <double> (clock::now() - start).count();
+        calls++;
+    } while (elapsed < min_seconds);
+
+    return print_benchmark(name, elapsed * 1e9 / (calls * operations_per_call));
+}
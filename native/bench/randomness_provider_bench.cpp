@@ -0,0 +1,125 @@
+/*
+
+Measures how many bounded random values the RandomnessProvider draws per second, compared with the
+provider that was used before, which hashed the previous block and reduced the values with a modulo.
+Most of the time is spent in sha256, so the numbers of the mock sha256 are only indicative of the chain.
+
+*/
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include <eosio/crypto.hpp>
+
+#include "bench.hpp"
+
+using namespace std;
+using namespace eosio;
+
+#include "../../src/randomness_provider.cpp"
+
+
+static const size_t NUM_DRAWS = 200;
+
+
+//The provider before the counter mode stream, block i + 1 being sha256(block i)
+class ChainedRandomnessProvider {
+public:
+    ChainedRandomnessProvider(checksum256 random_seed) {
+        raw_values = random_seed.extract_as_byte_array();
+        offset = 0;
+    }
+
+    uint64_t get_uint64() {
+        if (offset > 24) {
+            checksum256 new_hash = eosio::sha256((char *) raw_values.data(), 32);
+            raw_values = new_hash.extract_as_byte_array();
+            offset = 0;
+        }
+
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) {
+            value = (value << 8) + raw_values[offset];
+            offset++;
+        }
+        return value;
+    }
+
+    uint32_t get_rand(uint32_t max_value) {
+        return get_uint64() % ((uint64_t) max_value);
+    }
+
+private:
+    array <uint8_t, 32> raw_values;
+    int offset;
+};
+
+
+int main() {
+    array <uint8_t, 32> seed_bytes;
+    for (size_t i = 0; i < seed_bytes.size(); i++) {
+        seed_bytes[i] = (uint8_t) (i * 37 + 11);
+    }
+    checksum256 seed(seed_bytes);
+
+    //Each call starts a new provider, like every unboxed pack does, and draws the rolls of a large pack
+    run_benchmark("chained provider, get_rand(1000003)", NUM_DRAWS, [&]() {
+        ChainedRandomnessProvider randomness_provider(seed);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < NUM_DRAWS; i++) {
+            sum += randomness_provider.get_rand(1000003);
+        }
+        benchmark_sink = benchmark_sink + sum;
+    });
+
+    run_benchmark("counter mode, get_uint64()", NUM_DRAWS, [&]() {
+        RandomnessProvider randomness_provider(seed);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < NUM_DRAWS; i++) {
+            sum += randomness_provider.get_uint64();
+        }
+        benchmark_sink = benchmark_sink + sum;
+    });
+
+    run_benchmark("counter mode, get_rand(1 << 20)", NUM_DRAWS, [&]() {
+        RandomnessProvider randomness_provider(seed);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < NUM_DRAWS; i++) {
+            sum += randomness_provider.get_rand(1 << 20);
+        }
+        benchmark_sink = benchmark_sink + sum;
+    });
+
+    run_benchmark("counter mode, get_rand(1000003)", NUM_DRAWS, [&]() {
+        RandomnessProvider randomness_provider(seed);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < NUM_DRAWS; i++) {
+            sum += randomness_provider.get_rand(1000003);
+        }
+        benchmark_sink = benchmark_sink + sum;
+    });
+
+    //Rejects almost half of the values, the worst case of the unbiased draws
+    run_benchmark("counter mode, get_rand_uint64(2^63 + 1)", NUM_DRAWS, [&]() {
+        RandomnessProvider randomness_provider(seed);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < NUM_DRAWS; i++) {
+            sum += randomness_provider.get_rand_uint64((1ULL << 63) + 1);
+        }
+        benchmark_sink = benchmark_sink + sum;
+    });
+
+    vector <uint64_t> bounds(NUM_DRAWS);
+    for (size_t i = 0; i < NUM_DRAWS; i++) {
+        bounds[i] = (i % 50 + 1) * 1000003ULL;
+    }
+    vector <uint64_t> values;
+    run_benchmark("counter mode, fill(200 bounds)", NUM_DRAWS, [&]() {
+        RandomnessProvider randomness_provider(seed);
+        randomness_provider.fill(values, bounds);
+        benchmark_sink = benchmark_sink + values.back();
+    });
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+
+Native stand-in for the eosio action header, only used by the native tests and tools.
+Sent inline actions are recorded in the chain state, where the test harness can execute or inspect them.
+
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "chain.hpp"
+#include "check.hpp"
+#include "datastream.hpp"
+#include "name.hpp"
+
+namespace eosio {
+
+    inline bool has_auth(name account) {
+        return native::chain().authorizations.count(account.value) != 0;
+    }
+
+    inline void require_auth(name account) {
+        check(has_auth(account), "missing authority of " + account.to_string());
+    }
+
+    inline bool is_account(name account) {
+        return account.value != 0;
+    }
+
+
+    struct action {
+        eosio::name                     account;
+        eosio::name                     name;
+        std::vector <permission_level>  authorization;
+        std::vector <char>              data;
+
+        template <typename T>
+        action(const permission_level &auth, eosio::name account, eosio::name action_name, T &&value) :
+            account(account), name(action_name), authorization({auth}), data(pack(value)) {}
+
+        template <typename T>
+        action(std::vector <permission_level> auths, eosio::name account, eosio::name action_name, T &&value) :
+            account(account), name(action_name), authorization(std::move(auths)), data(pack(value)) {}
+
+        void send() const {
+            native::chain().sent_actions.push_back({account, name, authorization, data});
+        }
+    };
+}
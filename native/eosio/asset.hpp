@@ -0,0 +1,50 @@
+/*
+
+Native stand-in for the eosio asset header, only used by the native tests and tools.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "name.hpp"
+
+namespace eosio {
+
+    class symbol {
+    public:
+        constexpr symbol() : value(0) {}
+
+        constexpr explicit symbol(uint64_t raw) : value(raw) {}
+
+        constexpr symbol(const char *code, uint8_t precision) : value(precision) {
+            for (int i = 0; code[i] != 0 && i < 7; i++) {
+                value |= (uint64_t) code[i] << (8 * (i + 1));
+            }
+        }
+
+        constexpr uint64_t raw() const { return value; }
+
+        constexpr bool operator==(const symbol &other) const { return value == other.value; }
+
+    private:
+        uint64_t value;
+    };
+
+
+    struct asset {
+        asset() : amount(0) {}
+
+        asset(int64_t amount, symbol sym) : amount(amount), symbol(sym) {}
+
+        int64_t      amount;
+        eosio::symbol symbol;
+    };
+
+
+    struct extended_symbol {
+        eosio::symbol sym;
+        name          contract;
+    };
+}
@@ -0,0 +1,47 @@
+/*
+
+Native stand-in for the eosio binary_extension header, only used by the native tests and tools.
+
+*/
+
+#pragma once
+
+#include <optional>
+
+#include "check.hpp"
+
+namespace eosio {
+
+    //A field that can be missing at the end of a serialized row or action, e.g. in rows written before it was added
+    template <typename T>
+    class binary_extension {
+    public:
+        binary_extension() {}
+
+        binary_extension(const T &value) : stored_value(value) {}
+
+        bool has_value() const { return stored_value.has_value(); }
+
+        const T &value() const {
+            check(has_value(), "cannot get value of empty binary_extension");
+            return *stored_value;
+        }
+
+        T &value() {
+            check(has_value(), "cannot get value of empty binary_extension");
+            return *stored_value;
+        }
+
+        T value_or(const T &default_value = T()) const { return stored_value.value_or(default_value); }
+
+        T &emplace(const T &value) {
+            stored_value = value;
+            return *stored_value;
+        }
+
+        void reset() { stored_value.reset(); }
+
+    private:
+        std::optional <T> stored_value;
+    };
+}
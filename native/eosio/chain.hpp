@@ -0,0 +1,241 @@
+/*
+
+State of the native stand-in for the chain, only used by the native tests and tools.
+
+Holds the serialized rows of all tables, the RAM billed to each account, the authorizations of the current action,
+the inline actions it sent and the rows it wrote and read. RAM is billed like on chain: each row costs its serialized
+size plus an overhead, each secondary index entry and each table (per code, scope and table name) costs a fixed
+amount, and modifying a row bills the size difference to its payer. The overheads are those of the cost model
+in atomicpacks.hpp.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "check.hpp"
+#include "name.hpp"
+
+namespace eosio {
+
+    struct permission_level {
+        name actor;
+        name permission;
+    };
+
+    namespace native {
+
+        static constexpr int64_t ROW_OVERHEAD_BYTES             = 112;
+        static constexpr int64_t TABLE_OVERHEAD_BYTES           = 112;
+        static constexpr int64_t SECONDARY_INDEX_OVERHEAD_BYTES = 128;
+
+        struct TABLE_ID {
+            uint64_t code;
+            uint64_t scope;
+            uint64_t table;
+
+            bool operator<(const TABLE_ID &other) const {
+                return std::tie(code, scope, table) < std::tie(other.code, other.scope, other.table);
+            }
+        };
+
+        struct STORED_ROW {
+            std::vector <char>     data;
+            name                   payer;
+            std::vector <uint64_t> secondary_keys;
+            uint64_t               version; //Changes whenever the row is written, so that cached objects can be checked
+        };
+
+        struct STORED_TABLE {
+            name                                       payer;         //Of the row that created the table
+            std::map <uint64_t, STORED_ROW>            rows;
+            std::vector <std::set <std::pair <uint64_t, uint64_t>>> secondary_indices; //(secondary key, primary key)
+        };
+
+        struct SENT_ACTION {
+            name                            account;
+            name                            action_name;
+            std::vector <permission_level>  authorization;
+            std::vector <char>              data;
+        };
+
+        struct DB_OPERATION {
+            enum TYPE { EMPLACE, MODIFY, ERASE };
+
+            TYPE     type;
+            TABLE_ID table_id;
+            uint64_t primary_key;
+            name     payer;
+            int64_t  ram_delta; //Of the row and its secondary index entries, without the table overheads
+        };
+
+
+        class chain_state {
+        public:
+            std::map <TABLE_ID, STORED_TABLE> tables;
+            std::map <uint64_t, int64_t>      ram_usage;
+
+            //Reset by the test harness for each action
+            name                        receiver;
+            std::set <uint64_t>         authorizations;
+            std::vector <SENT_ACTION>   sent_actions;
+            std::vector <DB_OPERATION>  db_operations;
+            std::vector <std::pair <TABLE_ID, uint64_t>> db_reads; //Rows loaded by multi_index, i.e. deserialized
+
+            uint32_t block_time         = 1700000000;
+            uint32_t tapos_block_prefix = 0x12345678;
+            uint64_t next_version       = 1;
+
+            //Iterators handed out by db_find_i64
+            std::vector <std::pair <TABLE_ID, uint64_t>> db_iterators;
+
+            const STORED_ROW *find_row(const TABLE_ID &table_id, uint64_t primary_key) const {
+                auto table_itr = tables.find(table_id);
+                if (table_itr == tables.end()) {
+                    return nullptr;
+                }
+                auto row_itr = table_itr->second.rows.find(primary_key);
+                return row_itr != table_itr->second.rows.end() ? &row_itr->second : nullptr;
+            }
+
+            const std::map <uint64_t, STORED_ROW> *get_rows(const TABLE_ID &table_id) const {
+                static const std::map <uint64_t, STORED_ROW> no_rows = {};
+                auto table_itr = tables.find(table_id);
+                return table_itr != tables.end() ? &table_itr->second.rows : &no_rows;
+            }
+
+            const std::set <std::pair <uint64_t, uint64_t>> *get_secondary_index(const TABLE_ID &table_id, size_t index) const {
+                static const std::set <std::pair <uint64_t, uint64_t>> no_entries = {};
+                auto table_itr = tables.find(table_id);
+                if (table_itr == tables.end() || index >= table_itr->second.secondary_indices.size()) {
+                    return &no_entries;
+                }
+                return &table_itr->second.secondary_indices[index];
+            }
+
+            uint64_t emplace_row(
+                const TABLE_ID &table_id,
+                uint64_t primary_key,
+                std::vector <char> data,
+                name payer,
+                std::vector <uint64_t> secondary_keys
+            ) {
+                check(payer.value != 0, "must specify a valid account to pay for new record");
+
+                STORED_TABLE &table = tables[table_id];
+                check(table.rows.find(primary_key) == table.rows.end(),
+                    "could not insert object, most likely a uniqueness constraint was violated");
+
+                int64_t ram_delta = get_row_bytes(data, secondary_keys);
+                if (table.rows.empty()) {
+                    //The table of each secondary index is created as well
+                    table.payer = payer;
+                    table.secondary_indices.resize(secondary_keys.size());
+                    ram_usage[payer.value] += TABLE_OVERHEAD_BYTES * (int64_t) (1 + secondary_keys.size());
+                }
+
+                for (size_t i = 0; i < secondary_keys.size(); i++) {
+                    table.secondary_indices[i].insert({secondary_keys[i], primary_key});
+                }
+
+                uint64_t version = next_version++;
+                table.rows[primary_key] = {std::move(data), payer, std::move(secondary_keys), version};
+
+                ram_usage[payer.value] += ram_delta;
+                db_operations.push_back({DB_OPERATION::EMPLACE, table_id, primary_key, payer, ram_delta});
+                return version;
+            }
+
+            uint64_t modify_row(
+                const TABLE_ID &table_id,
+                uint64_t primary_key,
+                std::vector <char> data,
+                name payer,
+                std::vector <uint64_t> secondary_keys
+            ) {
+                STORED_TABLE &table = tables[table_id];
+                auto row_itr = table.rows.find(primary_key);
+                check(row_itr != table.rows.end(), "cannot modify a row that does not exist");
+                STORED_ROW &row = row_itr->second;
+
+                int64_t old_bytes = get_row_bytes(row.data, row.secondary_keys);
+                int64_t new_bytes = get_row_bytes(data, secondary_keys);
+                name new_payer = payer.value != 0 ? payer : row.payer;
+
+                //A new payer is billed for the whole row, and the previous payer is refunded
+                ram_usage[row.payer.value] -= old_bytes;
+                ram_usage[new_payer.value] += new_bytes;
+
+                for (size_t i = 0; i < secondary_keys.size(); i++) {
+                    table.secondary_indices[i].erase({row.secondary_keys[i], primary_key});
+                    table.secondary_indices[i].insert({secondary_keys[i], primary_key});
+                }
+
+                row.data = std::move(data);
+                row.payer = new_payer;
+                row.secondary_keys = std::move(secondary_keys);
+                row.version = next_version++;
+
+                db_operations.push_back({DB_OPERATION::MODIFY, table_id, primary_key, new_payer, new_bytes - old_bytes});
+                return row.version;
+            }
+
+            void erase_row(const TABLE_ID &table_id, uint64_t primary_key) {
+                STORED_TABLE &table = tables[table_id];
+                auto row_itr = table.rows.find(primary_key);
+                check(row_itr != table.rows.end(), "cannot erase a row that does not exist");
+                STORED_ROW &row = row_itr->second;
+
+                int64_t ram_delta = -get_row_bytes(row.data, row.secondary_keys);
+                name payer = row.payer;
+                ram_usage[payer.value] += ram_delta;
+
+                for (size_t i = 0; i < row.secondary_keys.size(); i++) {
+                    table.secondary_indices[i].erase({row.secondary_keys[i], primary_key});
+                }
+                table.rows.erase(row_itr);
+
+                if (table.rows.empty()) {
+                    ram_usage[table.payer.value] -= TABLE_OVERHEAD_BYTES * (int64_t) (1 + table.secondary_indices.size());
+                    tables.erase(table_id);
+                }
+
+                db_operations.push_back({DB_OPERATION::ERASE, table_id, primary_key, payer, ram_delta});
+            }
+
+            int64_t get_ram_usage(name account) const {
+                auto itr = ram_usage.find(account.value);
+                return itr != ram_usage.end() ? itr->second : 0;
+            }
+
+            //RAM of the tables (not the rows) of a code and scope that is billed to the payer
+            int64_t get_table_overhead_bytes(name code, uint64_t scope, name payer) const {
+                int64_t bytes = 0;
+                for (const auto &[table_id, table] : tables) {
+                    if (table_id.code == code.value && table_id.scope == scope && table.payer == payer) {
+                        bytes += TABLE_OVERHEAD_BYTES * (int64_t) (1 + table.secondary_indices.size());
+                    }
+                }
+                return bytes;
+            }
+
+        private:
+            static int64_t get_row_bytes(const std::vector <char> &data, const std::vector <uint64_t> &secondary_keys) {
+                return ROW_OVERHEAD_BYTES + (int64_t) data.size()
+                    + SECONDARY_INDEX_OVERHEAD_BYTES * (int64_t) secondary_keys.size();
+            }
+        };
+
+
+        inline chain_state &chain() {
+            static chain_state state;
+            return state;
+        }
+    }
+}
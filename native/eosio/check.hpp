@@ -0,0 +1,26 @@
+/*
+
+Native stand-in for the eosio check header, only used by the native tests and tools.
+
+*/
+
+#pragma once
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+namespace eosio {
+
+    //On chain, a failed check aborts the transaction. Natively it throws, unless an exception is already
+    //being thrown, e.g. when the destructor of a contract runs after its action failed
+    inline void check(bool pred, const char *message) {
+        if (!pred && std::uncaught_exceptions() == 0) {
+            throw std::runtime_error(message);
+        }
+    }
+
+    inline void check(bool pred, const std::string &message) {
+        check(pred, message.c_str());
+    }
+}
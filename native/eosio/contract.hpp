@@ -0,0 +1,37 @@
+/*
+
+Native stand-in for the eosio contract header, only used by the native tests and tools.
+
+*/
+
+#pragma once
+
+#include "datastream.hpp"
+#include "name.hpp"
+
+#define ACTION   [[eosio::action]] void
+#define TABLE    struct [[eosio::table]]
+#define CONTRACT class [[eosio::contract]]
+
+namespace eosio {
+
+    class contract {
+    public:
+        contract(name self, name first_receiver, datastream <const char *> ds) :
+            _self(self), _first_receiver(first_receiver), _ds(ds) {}
+
+        //Contracts can do work in their destructor that fails the action, like on chain
+        ~contract() noexcept(false) {}
+
+        name get_self() const { return _self; }
+
+        name get_first_receiver() const { return _first_receiver; }
+
+        datastream <const char *> &get_datastream() { return _ds; }
+
+    protected:
+        name                      _self;
+        name                      _first_receiver;
+        datastream <const char *> _ds;
+    };
+}
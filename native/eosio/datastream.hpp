@@ -0,0 +1,380 @@
+/*
+
+Native stand-in for the eosio datastream header, only used by the native tests and tools.
+
+Uses the same binary format as the chain. Structs are serialized field by field in declaration order, which the
+CDT does with generated code. Natively, the fields are enumerated with structured bindings instead, which
+works for all aggregates with up to 16 fields, like the table rows and action parameters of the contracts.
+
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "asset.hpp"
+#include "binary_extension.hpp"
+#include "check.hpp"
+#include "crypto.hpp"
+#include "name.hpp"
+
+namespace eosio {
+
+    namespace reflection {
+
+        //Converts to any type, used to count the fields of an aggregate by initializing it
+        struct any_field {
+            template <typename T>
+            operator T() const;
+        };
+
+        template <size_t>
+        using any_field_t = any_field;
+
+        template <typename T, typename INDICES, typename = void>
+        struct is_initializable : std::false_type {};
+
+        template <typename T, size_t... I>
+        struct is_initializable <T, std::index_sequence <I...>, std::void_t <decltype(T{any_field_t <I> {}...})>>
+            : std::true_type {};
+
+        template <typename T, size_t N = 16>
+        constexpr size_t count_fields() {
+            if constexpr (N == 0 || is_initializable <T, std::make_index_sequence <N>>::value) {
+                return N;
+            } else {
+                return count_fields <T, N - 1>();
+            }
+        }
+
+        template <typename T, typename F>
+        void for_each_field(T &value, F &&f) {
+            constexpr size_t num_fields = count_fields <std::remove_const_t <T>>();
+            static_assert(num_fields <= 16, "Too many fields to serialize");
+
+            if constexpr (num_fields == 1) {
+                auto &[a] = value;
+                f(a);
+            } else if constexpr (num_fields == 2) {
+                auto &[a, b] = value;
+                f(a); f(b);
+            } else if constexpr (num_fields == 3) {
+                auto &[a, b, c] = value;
+                f(a); f(b); f(c);
+            } else if constexpr (num_fields == 4) {
+                auto &[a, b, c, d] = value;
+                f(a); f(b); f(c); f(d);
+            } else if constexpr (num_fields == 5) {
+                auto &[a, b, c, d, e] = value;
+                f(a); f(b); f(c); f(d); f(e);
+            } else if constexpr (num_fields == 6) {
+                auto &[a, b, c, d, e, g] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g);
+            } else if constexpr (num_fields == 7) {
+                auto &[a, b, c, d, e, g, h] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g); f(h);
+            } else if constexpr (num_fields == 8) {
+                auto &[a, b, c, d, e, g, h, i] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i);
+            } else if constexpr (num_fields == 9) {
+                auto &[a, b, c, d, e, g, h, i, j] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j);
+            } else if constexpr (num_fields == 10) {
+                auto &[a, b, c, d, e, g, h, i, j, k] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k);
+            } else if constexpr (num_fields == 11) {
+                auto &[a, b, c, d, e, g, h, i, j, k, l] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l);
+            } else if constexpr (num_fields == 12) {
+                auto &[a, b, c, d, e, g, h, i, j, k, l, m] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m);
+            } else if constexpr (num_fields == 13) {
+                auto &[a, b, c, d, e, g, h, i, j, k, l, m, n] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); f(n);
+            } else if constexpr (num_fields == 14) {
+                auto &[a, b, c, d, e, g, h, i, j, k, l, m, n, o] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); f(n); f(o);
+            } else if constexpr (num_fields == 15) {
+                auto &[a, b, c, d, e, g, h, i, j, k, l, m, n, o, p] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); f(n); f(o); f(p);
+            } else if constexpr (num_fields == 16) {
+                auto &[a, b, c, d, e, g, h, i, j, k, l, m, n, o, p, q] = value;
+                f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); f(n); f(o); f(p); f(q);
+            }
+        }
+
+        template <typename T> struct is_vector : std::false_type {};
+        template <typename T, typename A> struct is_vector <std::vector <T, A>> : std::true_type {};
+
+        template <typename T> struct is_map : std::false_type {};
+        template <typename K, typename V, typename C, typename A> struct is_map <std::map <K, V, C, A>> : std::true_type {};
+
+        template <typename T> struct is_array : std::false_type {};
+        template <typename T, size_t N> struct is_array <std::array <T, N>> : std::true_type {};
+
+        template <typename T> struct is_pair : std::false_type {};
+        template <typename A, typename B> struct is_pair <std::pair <A, B>> : std::true_type {};
+
+        template <typename T> struct is_tuple : std::false_type {};
+        template <typename... T> struct is_tuple <std::tuple <T...>> : std::true_type {};
+
+        template <typename T> struct is_variant : std::false_type {};
+        template <typename... T> struct is_variant <std::variant <T...>> : std::true_type {};
+
+        template <typename T> struct is_binary_extension : std::false_type {};
+        template <typename T> struct is_binary_extension <binary_extension <T>> : std::true_type {};
+    }
+
+
+    template <typename STREAM>
+    class datastream;
+
+    //Reads from a buffer
+    template <>
+    class datastream <const char *> {
+    public:
+        datastream(const char *start, size_t size) : start(start), position(start), end(start + size) {}
+
+        void read(char *data, size_t size) {
+            check(size <= remaining(), "datastream attempted to read past the end");
+            memcpy(data, position, size);
+            position += size;
+        }
+
+        size_t remaining() const { return end - position; }
+
+        size_t tellp() const { return position - start; }
+
+        template <typename T>
+        datastream &operator>>(T &value);
+
+    private:
+        const char *start;
+        const char *position;
+        const char *end;
+    };
+
+    //Appends to a vector, which takes the place of the fixed size buffers used on chain
+    template <>
+    class datastream <std::vector <char> *> {
+    public:
+        explicit datastream(std::vector <char> *buffer) : buffer(buffer) {}
+
+        void write(const char *data, size_t size) {
+            buffer->insert(buffer->end(), data, data + size);
+        }
+
+        size_t tellp() const { return buffer->size(); }
+
+        template <typename T>
+        datastream &operator<<(const T &value);
+
+    private:
+        std::vector <char> *buffer;
+    };
+
+    typedef datastream <const char *>         read_stream;
+    typedef datastream <std::vector <char> *> write_stream;
+
+
+    inline void write_unsigned_varint(write_stream &ds, uint64_t value) {
+        do {
+            char byte = value & 0x7F;
+            value >>= 7;
+            if (value != 0) {
+                byte |= 0x80;
+            }
+            ds.write(&byte, 1);
+        } while (value != 0);
+    }
+
+    inline uint64_t read_unsigned_varint(read_stream &ds) {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            char byte;
+            ds.read(&byte, 1);
+            value |= (uint64_t) (byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        check(false, "varint is too long");
+        return 0;
+    }
+
+
+    template <typename T>
+    void write_value(write_stream &ds, const T &value) {
+        using namespace reflection;
+
+        if constexpr (std::is_arithmetic_v <T> || std::is_enum_v <T>) {
+            ds.write((const char *) &value, sizeof(value));
+        } else if constexpr (std::is_same_v <T, name>) {
+            write_value(ds, value.value);
+        } else if constexpr (std::is_same_v <T, symbol>) {
+            write_value(ds, value.raw());
+        } else if constexpr (std::is_same_v <T, asset>) {
+            write_value(ds, value.amount);
+            write_value(ds, value.symbol);
+        } else if constexpr (std::is_same_v <T, checksum256>) {
+            std::array <uint8_t, 32> bytes = value.extract_as_byte_array();
+            ds.write((const char *) bytes.data(), bytes.size());
+        } else if constexpr (std::is_same_v <T, std::string>) {
+            write_unsigned_varint(ds, value.size());
+            ds.write(value.data(), value.size());
+        } else if constexpr (is_vector <T>::value || is_map <T>::value) {
+            write_unsigned_varint(ds, value.size());
+            for (const auto &item : value) {
+                write_value(ds, item);
+            }
+        } else if constexpr (is_array <T>::value) {
+            for (const auto &item : value) {
+                write_value(ds, item);
+            }
+        } else if constexpr (is_pair <T>::value) {
+            write_value(ds, value.first);
+            write_value(ds, value.second);
+        } else if constexpr (is_tuple <T>::value) {
+            std::apply([&](const auto &... items) { (write_value(ds, items), ...); }, value);
+        } else if constexpr (is_variant <T>::value) {
+            write_unsigned_varint(ds, value.index());
+            std::visit([&](const auto &item) { write_value(ds, item); }, value);
+        } else if constexpr (is_binary_extension <T>::value) {
+            if (value.has_value()) {
+                write_value(ds, value.value());
+            }
+        } else {
+            static_assert(std::is_aggregate_v <T>, "Type can't be serialized");
+            for_each_field(value, [&](const auto &field) { write_value(ds, field); });
+        }
+    }
+
+
+    template <typename VARIANT, size_t I = 0>
+    void read_variant(read_stream &ds, VARIANT &value, uint64_t index) {
+        if constexpr (I < std::variant_size_v <VARIANT>) {
+            if (index == I) {
+                std::variant_alternative_t <I, VARIANT> item;
+                read_value(ds, item);
+                value = std::move(item);
+            } else {
+                read_variant <VARIANT, I + 1>(ds, value, index);
+            }
+        } else {
+            check(false, "invalid variant index");
+        }
+    }
+
+    template <typename T>
+    void read_value(read_stream &ds, T &value) {
+        using namespace reflection;
+
+        if constexpr (std::is_arithmetic_v <T> || std::is_enum_v <T>) {
+            ds.read((char *) &value, sizeof(value));
+        } else if constexpr (std::is_same_v <T, name>) {
+            read_value(ds, value.value);
+        } else if constexpr (std::is_same_v <T, symbol>) {
+            uint64_t raw;
+            read_value(ds, raw);
+            value = symbol(raw);
+        } else if constexpr (std::is_same_v <T, asset>) {
+            read_value(ds, value.amount);
+            read_value(ds, value.symbol);
+        } else if constexpr (std::is_same_v <T, checksum256>) {
+            std::array <uint8_t, 32> bytes;
+            ds.read((char *) bytes.data(), bytes.size());
+            value = checksum256(bytes);
+        } else if constexpr (std::is_same_v <T, std::string>) {
+            value.resize(read_unsigned_varint(ds));
+            ds.read(value.data(), value.size());
+        } else if constexpr (is_vector <T>::value) {
+            uint64_t size = read_unsigned_varint(ds);
+            check(size <= ds.remaining(), "vector size exceeds the remaining data");
+            value.clear();
+            value.resize(size);
+            for (auto &item : value) {
+                read_value(ds, item);
+            }
+        } else if constexpr (is_map <T>::value) {
+            uint64_t size = read_unsigned_varint(ds);
+            value.clear();
+            for (uint64_t i = 0; i < size; i++) {
+                std::pair <typename T::key_type, typename T::mapped_type> item;
+                read_value(ds, item);
+                value.insert(std::move(item));
+            }
+        } else if constexpr (is_array <T>::value) {
+            for (auto &item : value) {
+                read_value(ds, item);
+            }
+        } else if constexpr (is_pair <T>::value) {
+            read_value(ds, value.first);
+            read_value(ds, value.second);
+        } else if constexpr (is_tuple <T>::value) {
+            std::apply([&](auto &... items) { (read_value(ds, items), ...); }, value);
+        } else if constexpr (is_variant <T>::value) {
+            read_variant(ds, value, read_unsigned_varint(ds));
+        } else if constexpr (is_binary_extension <T>::value) {
+            //Only present if there is data left
+            if (ds.remaining() != 0) {
+                typename std::remove_reference_t <decltype(value.value())> item;
+                read_value(ds, item);
+                value.emplace(item);
+            } else {
+                value.reset();
+            }
+        } else {
+            static_assert(std::is_aggregate_v <T>, "Type can't be deserialized");
+            for_each_field(value, [&](auto &field) { read_value(ds, field); });
+        }
+    }
+
+
+    template <typename T>
+    datastream <const char *> &datastream <const char *>::operator>>(T &value) {
+        read_value(*this, value);
+        return *this;
+    }
+
+    template <typename T>
+    datastream <std::vector <char> *> &datastream <std::vector <char> *>::operator<<(const T &value) {
+        write_value(*this, value);
+        return *this;
+    }
+
+
+    template <typename T>
+    std::vector <char> pack(const T &value) {
+        std::vector <char> data = {};
+        write_stream ds(&data);
+        write_value(ds, value);
+        return data;
+    }
+
+    template <typename T>
+    size_t pack_size(const T &value) {
+        return pack(value).size();
+    }
+
+    template <typename T>
+    T unpack(const char *data, size_t size) {
+        T value{};
+        read_stream ds(data, size);
+        read_value(ds, value);
+        return value;
+    }
+
+    template <typename T>
+    T unpack(const std::vector <char> &data) {
+        return unpack <T>(data.data(), data.size());
+    }
+}
@@ -0,0 +1,31 @@
+/*
+
+Native stand-in for the eosio headers, only used by the native tests and tools.
+
+Contracts can be built natively against these headers. Instead of a chain, the tables, RAM usage, authorizations
+and sent inline actions are kept in memory (see chain.hpp), so that tests can run actions and inspect the results.
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "action.hpp"
+#include "asset.hpp"
+#include "binary_extension.hpp"
+#include "chain.hpp"
+#include "check.hpp"
+#include "contract.hpp"
+#include "crypto.hpp"
+#include "datastream.hpp"
+#include "multi_index.hpp"
+#include "name.hpp"
+#include "system.hpp"
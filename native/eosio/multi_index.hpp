@@ -0,0 +1,405 @@
+/*
+
+Native stand-in for the eosio multi_index header, only used by the native tests and tools.
+
+Rows are stored serialized in the chain state, so that tables with the same code, scope and name share their rows,
+and their RAM is billed like on chain. Like on chain, each multi_index instance caches the objects it has loaded,
+and iterators stay valid when other rows are erased.
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "chain.hpp"
+#include "check.hpp"
+#include "datastream.hpp"
+#include "name.hpp"
+
+namespace eosio {
+
+    static constexpr name same_payer = name();
+
+
+    template <uint64_t IndexName, typename EXTRACTOR>
+    struct indexed_by {
+        static constexpr uint64_t index_name = IndexName;
+        typedef EXTRACTOR secondary_extractor_type;
+    };
+
+    template <typename T, typename K, K (T::*F)() const>
+    struct const_mem_fun {
+        typedef K result_type;
+
+        K operator()(const T &object) const { return (object.*F)(); }
+    };
+
+
+    template <uint64_t TableName, typename T, typename... INDICES>
+    class multi_index {
+    private:
+        struct ITEM {
+            T        object;
+            uint64_t version;
+        };
+
+    public:
+        class const_iterator {
+        public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef T                               value_type;
+            typedef std::ptrdiff_t                  difference_type;
+            typedef const T                         *pointer;
+            typedef const T                         &reference;
+
+            const_iterator() : table(nullptr), primary_key(0), item(nullptr) {}
+
+            const T &operator*() const {
+                check(item != nullptr, "cannot dereference end iterator");
+                return item->object;
+            }
+
+            const T *operator->() const { return &**this; }
+
+            const_iterator &operator++() {
+                check(item != nullptr, "cannot increment end iterator");
+                *this = table->upper_bound(primary_key);
+                return *this;
+            }
+
+            const_iterator operator++(int) {
+                const_iterator previous = *this;
+                ++*this;
+                return previous;
+            }
+
+            const_iterator &operator--() {
+                const std::map <uint64_t, native::STORED_ROW> *rows = native::chain().get_rows(table->get_table_id());
+                auto row_itr = item == nullptr ? rows->end() : rows->lower_bound(primary_key);
+                check(row_itr != rows->begin(), "cannot decrement iterator at beginning of table");
+                *this = table->find((--row_itr)->first);
+                return *this;
+            }
+
+            const_iterator operator--(int) {
+                const_iterator previous = *this;
+                --*this;
+                return previous;
+            }
+
+            bool operator==(const const_iterator &other) const {
+                return item == other.item && (item == nullptr || primary_key == other.primary_key);
+            }
+
+            bool operator!=(const const_iterator &other) const { return !(*this == other); }
+
+        private:
+            friend class multi_index;
+
+            const_iterator(const multi_index *table, uint64_t primary_key, std::shared_ptr <ITEM> item) :
+                table(table), primary_key(primary_key), item(item) {}
+
+            const multi_index      *table;
+            uint64_t               primary_key;
+            std::shared_ptr <ITEM> item;
+        };
+
+
+        //Secondary index, iterated in the order of the secondary keys and then of the primary keys
+        template <size_t INDEX>
+        class index {
+        private:
+            typedef typename std::tuple_element <INDEX, std::tuple <INDICES...>>::type::secondary_extractor_type
+                EXTRACTOR;
+
+        public:
+            class const_iterator {
+            public:
+                const_iterator() : table(nullptr), secondary_key(0), primary_key(0), at_end(true) {}
+
+                const T &operator*() const {
+                    check(!at_end, "cannot dereference end iterator");
+                    return *table->find(primary_key);
+                }
+
+                const T *operator->() const { return &**this; }
+
+                const_iterator &operator++() {
+                    check(!at_end, "cannot increment end iterator");
+                    *this = make_iterator(table, get_entries(table)->upper_bound({secondary_key, primary_key}));
+                    return *this;
+                }
+
+                const_iterator operator++(int) {
+                    const_iterator previous = *this;
+                    ++*this;
+                    return previous;
+                }
+
+                bool operator==(const const_iterator &other) const {
+                    return at_end == other.at_end
+                        && (at_end || (secondary_key == other.secondary_key && primary_key == other.primary_key));
+                }
+
+                bool operator!=(const const_iterator &other) const { return !(*this == other); }
+
+            private:
+                friend class index;
+
+                const multi_index *table;
+                uint64_t          secondary_key;
+                uint64_t          primary_key;
+                bool              at_end;
+            };
+
+            explicit index(const multi_index *table) : table(table) {}
+
+            const_iterator begin() const { return make_iterator(table, get_entries(table)->begin()); }
+
+            const_iterator end() const {
+                const_iterator itr;
+                itr.table = table;
+                return itr;
+            }
+
+            const_iterator lower_bound(uint64_t secondary_key) const {
+                return make_iterator(table, get_entries(table)->lower_bound({secondary_key, 0}));
+            }
+
+            const_iterator upper_bound(uint64_t secondary_key) const {
+                if (secondary_key == UINT64_MAX) {
+                    return end();
+                }
+                return make_iterator(table, get_entries(table)->lower_bound({secondary_key + 1, 0}));
+            }
+
+            const_iterator find(uint64_t secondary_key) const {
+                const_iterator itr = lower_bound(secondary_key);
+                return itr != end() && itr.secondary_key == secondary_key ? itr : end();
+            }
+
+            const_iterator require_find(uint64_t secondary_key, const char *error_msg = "unable to find secondary key") const {
+                const_iterator itr = find(secondary_key);
+                check(itr != end(), error_msg);
+                return itr;
+            }
+
+        private:
+            typedef std::set <std::pair <uint64_t, uint64_t>> ENTRIES;
+
+            static const ENTRIES *get_entries(const multi_index *table) {
+                return native::chain().get_secondary_index(table->get_table_id(), INDEX);
+            }
+
+            static const_iterator make_iterator(const multi_index *table, typename ENTRIES::const_iterator entry_itr) {
+                const_iterator itr;
+                itr.table = table;
+                if (entry_itr != get_entries(table)->end()) {
+                    itr.secondary_key = entry_itr->first;
+                    itr.primary_key = entry_itr->second;
+                    itr.at_end = false;
+                }
+                return itr;
+            }
+
+            const multi_index *table;
+        };
+
+
+        multi_index(name code, uint64_t scope) : code(code), scope(scope) {}
+
+        //Iterators point back to the table, so a copy starts with its own cache
+        multi_index(const multi_index &other) : code(other.code), scope(other.scope) {}
+
+        multi_index &operator=(const multi_index &other) {
+            code = other.code;
+            scope = other.scope;
+            cache.clear();
+            return *this;
+        }
+
+        name get_code() const { return code; }
+
+        uint64_t get_scope() const { return scope; }
+
+        const_iterator begin() const { return lower_bound(0); }
+
+        const_iterator end() const { return const_iterator(this, 0, nullptr); }
+
+        const_iterator cbegin() const { return begin(); }
+
+        const_iterator cend() const { return end(); }
+
+        const_iterator find(uint64_t primary_key) const {
+            return const_iterator(this, primary_key, load(primary_key));
+        }
+
+        const_iterator require_find(uint64_t primary_key, const char *error_msg = "unable to find key") const {
+            const_iterator itr = find(primary_key);
+            check(itr != end(), error_msg);
+            return itr;
+        }
+
+        const T &get(uint64_t primary_key, const char *error_msg = "unable to find key") const {
+            return *require_find(primary_key, error_msg);
+        }
+
+        const_iterator lower_bound(uint64_t primary_key) const {
+            const std::map <uint64_t, native::STORED_ROW> *rows = native::chain().get_rows(get_table_id());
+            auto row_itr = rows->lower_bound(primary_key);
+            return row_itr != rows->end() ? find(row_itr->first) : end();
+        }
+
+        const_iterator upper_bound(uint64_t primary_key) const {
+            const std::map <uint64_t, native::STORED_ROW> *rows = native::chain().get_rows(get_table_id());
+            auto row_itr = rows->upper_bound(primary_key);
+            return row_itr != rows->end() ? find(row_itr->first) : end();
+        }
+
+        uint64_t available_primary_key() const {
+            const std::map <uint64_t, native::STORED_ROW> *rows = native::chain().get_rows(get_table_id());
+            return rows->empty() ? 0 : rows->rbegin()->first + 1;
+        }
+
+        template <typename LAMBDA>
+        const_iterator emplace(name payer, LAMBDA &&constructor) {
+            check(code == native::chain().receiver || native::chain().receiver.value == 0,
+                "cannot create objects in table of another contract");
+
+            std::shared_ptr <ITEM> item = std::make_shared <ITEM>();
+            constructor(item->object);
+
+            uint64_t primary_key = item->object.primary_key();
+            item->version = native::chain().emplace_row(get_table_id(), primary_key, pack(item->object), payer,
+                get_secondary_keys(item->object));
+            cache[primary_key] = item;
+
+            return const_iterator(this, primary_key, item);
+        }
+
+        template <typename LAMBDA>
+        void modify(const const_iterator &itr, name payer, LAMBDA &&updater) {
+            check(itr != end(), "cannot pass end iterator to modify");
+            modify(*itr, payer, std::forward <LAMBDA>(updater));
+        }
+
+        template <typename LAMBDA>
+        void modify(const T &object, name payer, LAMBDA &&updater) {
+            check(code == native::chain().receiver || native::chain().receiver.value == 0,
+                "cannot modify objects in table of another contract");
+
+            uint64_t primary_key = object.primary_key();
+            std::shared_ptr <ITEM> item = load(primary_key);
+            check(item != nullptr && &item->object == &object, "object passed to modify is not in multi_index");
+
+            updater(item->object);
+            check(item->object.primary_key() == primary_key, "updater cannot change primary key when modifying an object");
+
+            item->version = native::chain().modify_row(get_table_id(), primary_key, pack(item->object), payer,
+                get_secondary_keys(item->object));
+        }
+
+        const_iterator erase(const_iterator itr) {
+            check(itr != end(), "cannot pass end iterator to erase");
+            const_iterator next_itr = itr;
+            ++next_itr;
+            erase(*itr);
+            return next_itr;
+        }
+
+        void erase(const T &object) {
+            check(code == native::chain().receiver || native::chain().receiver.value == 0,
+                "cannot erase objects in table of another contract");
+
+            uint64_t primary_key = object.primary_key();
+            native::chain().erase_row(get_table_id(), primary_key);
+            cache.erase(primary_key);
+        }
+
+        template <uint64_t IndexName>
+        auto get_index() const {
+            constexpr size_t index_number = get_index_number <IndexName, 0, INDICES...>();
+            return index <index_number>(this);
+        }
+
+        native::TABLE_ID get_table_id() const { return {code.value, scope, TableName}; }
+
+    private:
+        template <uint64_t IndexName, size_t I, typename FIRST, typename... REST>
+        static constexpr size_t get_index_number() {
+            if constexpr (FIRST::index_name == IndexName) {
+                return I;
+            } else {
+                return get_index_number <IndexName, I + 1, REST...>();
+            }
+        }
+
+        static std::vector <uint64_t> get_secondary_keys(const T &object) {
+            return {(uint64_t) typename INDICES::secondary_extractor_type()(object)...};
+        }
+
+        //Objects are reloaded if the row was written by another multi_index instance
+        std::shared_ptr <ITEM> load(uint64_t primary_key) const {
+            const native::STORED_ROW *row = native::chain().find_row(get_table_id(), primary_key);
+            if (row == nullptr) {
+                cache.erase(primary_key);
+                return nullptr;
+            }
+
+            auto cache_itr = cache.find(primary_key);
+            if (cache_itr != cache.end() && cache_itr->second->version == row->version) {
+                return cache_itr->second;
+            }
+
+            native::chain().db_reads.push_back({get_table_id(), primary_key});
+
+            std::shared_ptr <ITEM> item = std::make_shared <ITEM>();
+            item->object = unpack <T>(row->data);
+            item->version = row->version;
+            cache[primary_key] = item;
+            return item;
+        }
+
+        name     code;
+        uint64_t scope;
+
+        mutable std::map <uint64_t, std::shared_ptr <ITEM>> cache;
+    };
+}
+
+
+namespace eosio {
+    namespace internal_use_do_not_use {
+
+        //Returns a negative value if the row does not exist, like the end iterator on chain
+        inline int32_t db_find_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id) {
+            native::chain_state &chain = native::chain();
+            if (chain.find_row({code, scope, table}, id) == nullptr) {
+                return -1;
+            }
+            chain.db_iterators.push_back({{code, scope, table}, id});
+            return (int32_t) chain.db_iterators.size() - 1;
+        }
+
+        //Copies up to len bytes of the row and returns the number of copied bytes, or the size of the row if len is 0
+        inline int32_t db_get_i64(int32_t iterator, const void *data, uint32_t len) {
+            native::chain_state &chain = native::chain();
+            check(iterator >= 0 && (size_t) iterator < chain.db_iterators.size(), "invalid db iterator");
+
+            const auto &[table_id, primary_key] = chain.db_iterators[iterator];
+            const native::STORED_ROW *row = chain.find_row(table_id, primary_key);
+            check(row != nullptr, "dereference of deleted object");
+
+            if (len == 0) {
+                return (int32_t) row->data.size();
+            }
+            size_t copy_size = std::min <size_t>(len, row->data.size());
+            memcpy((void *) data, row->data.data(), copy_size);
+            return (int32_t) copy_size;
+        }
+    }
+}
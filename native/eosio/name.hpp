@@ -0,0 +1,65 @@
+/*
+
+Native stand-in for the eosio name header, only used by the native tests and tools.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace eosio {
+
+    class name {
+    public:
+        constexpr name() : value(0) {}
+
+        constexpr explicit name(uint64_t value) : value(value) {}
+
+        //Same encoding as on chain, 5 bits for each of the first 12 characters and 4 bits for the 13th
+        constexpr explicit name(const char *str) : value(0) {
+            int length = 0;
+            while (str[length] != 0) {
+                length++;
+            }
+            for (int i = 0; i < length && i < 13; i++) {
+                uint64_t c = char_to_value(str[i]);
+                value |= i < 12 ? (c & 0x1F) << (64 - 5 * (i + 1)) : c & 0x0F;
+            }
+        }
+
+        explicit name(const std::string &str) : name(str.c_str()) {}
+
+        constexpr operator uint64_t() const { return value; }
+
+        std::string to_string() const {
+            static const char *charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+
+            std::string str(13, '.');
+            uint64_t tmp = value;
+            for (int i = 0; i < 13; i++) {
+                char c = charmap[tmp & (i == 0 ? 0x0F : 0x1F)];
+                str[12 - i] = c;
+                tmp >>= (i == 0 ? 4 : 5);
+            }
+
+            size_t last = str.find_last_not_of('.');
+            return last == std::string::npos ? "" : str.substr(0, last + 1);
+        }
+
+        uint64_t value;
+
+    private:
+        static constexpr uint64_t char_to_value(char c) {
+            if (c == '.') {
+                return 0;
+            } else if (c >= '1' && c <= '5') {
+                return c - '1' + 1;
+            } else if (c >= 'a' && c <= 'z') {
+                return c - 'a' + 6;
+            }
+            return 0;
+        }
+    };
+}
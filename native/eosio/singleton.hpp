@@ -0,0 +1,58 @@
+/*
+
+Native stand-in for the eosio singleton header, only used by the native tests and tools.
+
+*/
+
+#pragma once
+
+#include "multi_index.hpp"
+
+namespace eosio {
+
+    //Stored as the only row of a table, with the table name as its primary key, like on chain
+    template <uint64_t SingletonName, typename T>
+    class singleton {
+    private:
+        struct row {
+            T value;
+
+            uint64_t primary_key() const { return SingletonName; }
+        };
+
+    public:
+        singleton(name code, uint64_t scope) : table(code, scope) {}
+
+        bool exists() const { return table.find(SingletonName) != table.end(); }
+
+        T get() const {
+            auto itr = table.find(SingletonName);
+            check(itr != table.end(), "singleton does not exist");
+            return itr->value;
+        }
+
+        T get_or_default(const T &default_value = T()) const {
+            auto itr = table.find(SingletonName);
+            return itr != table.end() ? itr->value : default_value;
+        }
+
+        void set(const T &value, name payer) {
+            auto itr = table.find(SingletonName);
+            if (itr != table.end()) {
+                table.modify(itr, payer, [&](row &_row) { _row.value = value; });
+            } else {
+                table.emplace(payer, [&](row &_row) { _row.value = value; });
+            }
+        }
+
+        void remove() {
+            auto itr = table.find(SingletonName);
+            if (itr != table.end()) {
+                table.erase(itr);
+            }
+        }
+
+    private:
+        multi_index <SingletonName, row> table;
+    };
+}
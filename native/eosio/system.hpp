@@ -0,0 +1,30 @@
+/*
+
+Native stand-in for the eosio system header, only used by the native tests and tools.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "chain.hpp"
+
+namespace eosio {
+
+    class time_point {
+    public:
+        explicit time_point(int64_t microseconds = 0) : microseconds(microseconds) {}
+
+        int64_t time_since_epoch() const { return microseconds; }
+
+        uint32_t sec_since_epoch() const { return (uint32_t) (microseconds / 1000000); }
+
+    private:
+        int64_t microseconds;
+    };
+
+    inline time_point current_time_point() {
+        return time_point((int64_t) native::chain().block_time * 1000000);
+    }
+}
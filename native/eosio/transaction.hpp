@@ -0,0 +1,18 @@
+/*
+
+Native stand-in for the eosio transaction header, only used by the native tests and tools.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "chain.hpp"
+
+namespace eosio {
+
+    inline uint32_t tapos_block_prefix() {
+        return native::chain().tapos_block_prefix;
+    }
+}
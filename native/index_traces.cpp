@@ -0,0 +1,516 @@
+/*
+
+Folds recorded action traces of the pack contract into an index file, and answers queries from that index
+without a node
+
+The traces are read as JSON lines, one action trace per line, either in the format of the state history / history
+api ({"receiver": ..., "act": {"account": ..., "name": ..., "data": {...}}, "global_sequence": ...}, with the
+receiver and global sequence also accepted within "receipt") or as the bare act object. Only traces whose receiver
+is the account of the action are folded, so that notifications are not counted twice. Traces with a global sequence
+that is not higher than the last folded one are skipped, so the same file can be folded again after it was appended to.
+
+Folded are lognewpack, lognewroll, lognewrolls, delpackroll and completepack for the packs, logresult for the results,
+claimunboxed, claimall and claimpending for the claims, and the atomicassets transfers with the memo "unbox" for the
+unboxer of each opened pack. claimall and claimpending don't log which results they claim, so they are replayed
+over the known results in the same order as the contract walks them. Packs with deferred results only log their
+results when they are claimed for the first time, so such a first claim is only folded if it is a claimunboxed.
+The transfers don't tell which pack was opened, so when claimall is replayed, packs with the lean unboxpacks flag
+whose results are not logged yet are counted as if they were part of the unboxer index.
+
+Usage:
+    index_traces fold <index file> <traces.jsonl> [--contract NAME]
+        Folds the traces into the index file, which is created if it does not exist
+    index_traces packs <index file> <collection name>
+    index_traces results <index file> <pack id>
+    index_traces pending <index file> <account>
+        Print one JSON object per line
+
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+
+#include "json.hpp"
+
+using namespace std;
+using namespace eosio;
+
+
+//Written at the beginning of the index file, changed whenever the layout of TRACE_INDEX changes
+static constexpr uint64_t INDEX_FORMAT_VERSION = 1;
+
+static const uint32_t UNBOX_FLAG_DIRECT_MINT     = 1 << 0;
+static const uint32_t UNBOX_FLAG_LEAN_UNBOXPACKS = 1 << 2;
+
+
+struct INDEXED_PACK {
+    uint64_t          pack_id = 0;
+    name              collection_name = {};
+    uint32_t          unlock_time = 0;
+    int32_t           pack_template_id = -1;
+    uint32_t          unbox_flags = 0;
+    vector <uint64_t> roll_ids = {};         //Roll id of each added roll, in the order in which they were added
+    vector <uint64_t> deleted_roll_ids = {};
+};
+
+struct INDEXED_RESULT {
+    uint64_t          pack_asset_id = 0;
+    uint64_t          pack_id = 0;
+    name              unboxer = {};
+    vector <uint64_t> origin_roll_ids = {};
+    vector <int32_t>  template_ids = {};
+    vector <uint8_t>  claimed = {};         //One entry per result
+    uint64_t          unclaimed_count = 0;
+};
+
+struct TRACE_INDEX {
+    uint64_t                           format_version = 0;
+    uint64_t                           last_global_sequence = 0;
+    map <uint64_t, INDEXED_PACK>       packs = {};
+    map <uint64_t, INDEXED_RESULT>     results = {};         //By pack asset id
+    map <uint64_t, name>               waiting_packs = {};   //Unboxer of opened packs whose results are not logged yet
+    map <uint64_t, vector <uint64_t>>  early_claims = {};    //Rolls claimed before the results of the pack were logged
+};
+
+
+static TRACE_INDEX read_index(const string &file_name) {
+    ifstream file(file_name, ios::binary);
+    if (!file) {
+        return {.format_version = INDEX_FORMAT_VERSION, .last_global_sequence = 0};
+    }
+
+    vector <char> data((istreambuf_iterator <char> (file)), istreambuf_iterator <char> ());
+    TRACE_INDEX index = unpack <TRACE_INDEX> (data);
+    if (index.format_version != INDEX_FORMAT_VERSION) {
+        throw runtime_error("The index file " + file_name + " has an unsupported format version");
+    }
+    return index;
+}
+
+/**
+* Writes the index to a temporary file first, so that the index file is never left half written
+*/
+static void write_index(const string &file_name, const TRACE_INDEX &index) {
+    vector <char> data = pack(index);
+
+    string temporary_file_name = file_name + ".tmp";
+    {
+        ofstream file(temporary_file_name, ios::binary | ios::trunc);
+        file.write(data.data(), data.size());
+        if (!file) {
+            throw runtime_error("Can't write " + temporary_file_name);
+        }
+    }
+    if (rename(temporary_file_name.c_str(), file_name.c_str()) != 0) {
+        throw runtime_error("Can't replace " + file_name);
+    }
+}
+
+
+static const JSON_VALUE &get_member(const JSON_VALUE &object, const string &key) {
+    const JSON_VALUE *value = object.find(key);
+    if (value == nullptr) {
+        throw runtime_error("Missing field " + key);
+    }
+    return *value;
+}
+
+static name get_name(const JSON_VALUE &object, const string &key) {
+    return name(get_member(object, key).text);
+}
+
+
+/**
+* Returns the origin roll ids of the results of a pack, in the order in which they are logged
+* Each roll uses the roll ids from its own up to the one of the next added roll. The number of draws of the last
+* added roll is not logged, so it is what is left of the number of results
+* Without the rolls of the pack, e.g. if the traces start after it was created, the roll ids are assumed to have
+* no gaps
+*/
+static vector <uint64_t> get_origin_roll_ids(const TRACE_INDEX &index, uint64_t pack_id, size_t num_results) {
+    vector <uint64_t> origin_roll_ids = {};
+
+    auto pack_itr = index.packs.find(pack_id);
+    if (pack_itr != index.packs.end() && !pack_itr->second.roll_ids.empty()) {
+        const INDEXED_PACK &pack = pack_itr->second;
+        for (size_t i = 0; i < pack.roll_ids.size(); i++) {
+            if (std::find(pack.deleted_roll_ids.begin(), pack.deleted_roll_ids.end(), pack.roll_ids[i])
+                != pack.deleted_roll_ids.end()) {
+                continue;
+            }
+
+            uint64_t end_roll_id = i + 1 < pack.roll_ids.size()
+                ? pack.roll_ids[i + 1]
+                : pack.roll_ids[i] + (num_results - std::min(num_results, origin_roll_ids.size()));
+            for (uint64_t roll_id = pack.roll_ids[i]; roll_id < end_roll_id; roll_id++) {
+                origin_roll_ids.push_back(roll_id);
+            }
+        }
+
+        if (origin_roll_ids.size() == num_results) {
+            return origin_roll_ids;
+        }
+        fprintf(stderr, "The rolls of pack %llu don't match its %zu results, assuming roll ids without gaps\n",
+            (unsigned long long) pack_id, num_results);
+        origin_roll_ids.clear();
+    }
+
+    for (uint64_t roll_id = 0; roll_id < num_results; roll_id++) {
+        origin_roll_ids.push_back(roll_id);
+    }
+    return origin_roll_ids;
+}
+
+
+static void claim_roll(INDEXED_RESULT &result, uint64_t origin_roll_id) {
+    auto roll_itr = std::find(result.origin_roll_ids.begin(), result.origin_roll_ids.end(), origin_roll_id);
+    if (roll_itr == result.origin_roll_ids.end()) {
+        return;
+    }
+
+    uint8_t &claimed = result.claimed[roll_itr - result.origin_roll_ids.begin()];
+    if (!claimed) {
+        claimed = 1;
+        result.unclaimed_count--;
+    }
+}
+
+/**
+* Replays claimall and claimpending: The opened packs for which the filter returns true are walked in the order
+* of their pack asset ids, starting at start_pack_asset_id. Each claimed result and each pack without known
+* results uses up one unit of the budget
+*/
+template <typename FILTER>
+static void replay_claims(TRACE_INDEX &index, uint64_t start_pack_asset_id, uint32_t budget, FILTER &&filter) {
+    auto result_itr = index.results.lower_bound(start_pack_asset_id);
+    auto waiting_itr = index.waiting_packs.lower_bound(start_pack_asset_id);
+
+    while (budget != 0) {
+        bool use_waiting = waiting_itr != index.waiting_packs.end()
+            && (result_itr == index.results.end() || waiting_itr->first < result_itr->first);
+
+        if (use_waiting) {
+            if (filter(waiting_itr->first, waiting_itr->second)) {
+                budget--;
+            }
+            waiting_itr++;
+
+        } else if (result_itr != index.results.end()) {
+            INDEXED_RESULT &result = result_itr->second;
+            if (result.unclaimed_count != 0 && filter(result.pack_asset_id, result.unboxer)) {
+                for (size_t i = 0; i < result.claimed.size() && budget != 0; i++) {
+                    if (!result.claimed[i]) {
+                        result.claimed[i] = 1;
+                        result.unclaimed_count--;
+                        budget--;
+                    }
+                }
+            }
+            result_itr++;
+
+        } else {
+            break;
+        }
+    }
+}
+
+
+/**
+* Folds a single action trace into the index
+* Returns false if the trace is not folded, because it is a notification or of another action
+*/
+static bool fold_trace(TRACE_INDEX &index, const JSON_VALUE &trace, name contract_account) {
+    const JSON_VALUE *act = trace.find("act");
+    if (act == nullptr) {
+        act = &trace;
+    }
+    const JSON_VALUE *receipt = trace.find("receipt");
+
+    name account = get_name(*act, "account");
+    name action_name = get_name(*act, "name");
+
+    const JSON_VALUE *receiver = trace.find("receiver");
+    if (receiver == nullptr && receipt != nullptr) {
+        receiver = receipt->find("receiver");
+    }
+    if (receiver != nullptr && name(receiver->text) != account) {
+        return false;
+    }
+
+    const JSON_VALUE *global_sequence = trace.find("global_sequence");
+    if (global_sequence == nullptr && receipt != nullptr) {
+        global_sequence = receipt->find("global_sequence");
+    }
+    if (global_sequence != nullptr) {
+        if (global_sequence->as_uint64() <= index.last_global_sequence) {
+            return false;
+        }
+        index.last_global_sequence = global_sequence->as_uint64();
+    }
+
+    const JSON_VALUE &data = get_member(*act, "data");
+
+    if (account == name("atomicassets") && action_name == name("transfer")) {
+        if (get_name(data, "to") != contract_account || get_member(data, "memo").text != "unbox") {
+            return false;
+        }
+        for (const JSON_VALUE &asset_id : get_member(data, "asset_ids").items) {
+            index.waiting_packs[asset_id.as_uint64()] = get_name(data, "from");
+        }
+        return true;
+    }
+
+    if (account != contract_account) {
+        return false;
+    }
+
+    if (action_name == name("lognewpack")) {
+        uint64_t pack_id = get_member(data, "pack_id").as_uint64();
+        index.packs[pack_id] = {
+            .pack_id = pack_id,
+            .collection_name = get_name(data, "collection_name"),
+            .unlock_time = (uint32_t) get_member(data, "unlock_time").as_uint64(),
+            .pack_template_id = -1,
+            .unbox_flags = 0
+        };
+
+    } else if (action_name == name("lognewroll")) {
+        index.packs[get_member(data, "pack_id").as_uint64()].roll_ids.push_back(
+            get_member(data, "roll_id").as_uint64());
+
+    } else if (action_name == name("lognewrolls")) {
+        INDEXED_PACK &pack = index.packs[get_member(data, "pack_id").as_uint64()];
+        for (const JSON_VALUE &roll_id : get_member(data, "roll_ids").items) {
+            pack.roll_ids.push_back(roll_id.as_uint64());
+        }
+
+    } else if (action_name == name("delpackroll")) {
+        index.packs[get_member(data, "pack_id").as_uint64()].deleted_roll_ids.push_back(
+            get_member(data, "roll_id").as_uint64());
+
+    } else if (action_name == name("completepack")) {
+        INDEXED_PACK &pack = index.packs[get_member(data, "pack_id").as_uint64()];
+        pack.pack_template_id = (int32_t) get_member(data, "pack_template_id").as_int64();
+        const JSON_VALUE *unbox_flags = data.find("unbox_flags");
+        pack.unbox_flags = unbox_flags != nullptr && unbox_flags->type == JSON_VALUE::NUMBER
+            ? (uint32_t) unbox_flags->as_uint64()
+            : 0;
+
+    } else if (action_name == name("logresult")) {
+        uint64_t pack_asset_id = get_member(data, "pack_asset_id").as_uint64();
+        INDEXED_RESULT result = {
+            .pack_asset_id = pack_asset_id,
+            .pack_id = get_member(data, "pack_id").as_uint64(),
+            .unboxer = index.waiting_packs.count(pack_asset_id) ? index.waiting_packs[pack_asset_id] : name()
+        };
+        for (const JSON_VALUE &template_id : get_member(data, "template_ids").items) {
+            result.template_ids.push_back((int32_t) template_id.as_int64());
+        }
+        result.origin_roll_ids = get_origin_roll_ids(index, result.pack_id, result.template_ids.size());
+        result.claimed = vector <uint8_t> (result.template_ids.size(), 0);
+        result.unclaimed_count = result.template_ids.size();
+
+        auto pack_itr = index.packs.find(result.pack_id);
+        if (pack_itr != index.packs.end() && (pack_itr->second.unbox_flags & UNBOX_FLAG_DIRECT_MINT)) {
+            //The results are minted right away
+            for (uint64_t origin_roll_id : result.origin_roll_ids) {
+                claim_roll(result, origin_roll_id);
+            }
+        }
+        for (uint64_t origin_roll_id : index.early_claims[pack_asset_id]) {
+            claim_roll(result, origin_roll_id);
+        }
+        index.early_claims.erase(pack_asset_id);
+        index.waiting_packs.erase(pack_asset_id);
+        index.results[pack_asset_id] = result;
+
+    } else if (action_name == name("claimunboxed")) {
+        uint64_t pack_asset_id = get_member(data, "pack_asset_id").as_uint64();
+        auto result_itr = index.results.find(pack_asset_id);
+        for (const JSON_VALUE &origin_roll_id : get_member(data, "origin_roll_ids").items) {
+            if (result_itr != index.results.end()) {
+                claim_roll(result_itr->second, origin_roll_id.as_uint64());
+            } else {
+                index.early_claims[pack_asset_id].push_back(origin_roll_id.as_uint64());
+            }
+        }
+
+    } else if (action_name == name("claimall")) {
+        name unboxer = get_name(data, "unboxer");
+        //Packs with the lean unboxpacks flag are not part of the unboxer index that claimall walks
+        replay_claims(index, 0, (uint32_t) get_member(data, "max_claims").as_uint64(),
+            [&](uint64_t pack_asset_id, name pack_unboxer) {
+                if (pack_unboxer != unboxer) {
+                    return false;
+                }
+                auto result_itr = index.results.find(pack_asset_id);
+                if (result_itr == index.results.end()) {
+                    return true;
+                }
+                auto pack_itr = index.packs.find(result_itr->second.pack_id);
+                return pack_itr == index.packs.end() || !(pack_itr->second.unbox_flags & UNBOX_FLAG_LEAN_UNBOXPACKS);
+            });
+
+    } else if (action_name == name("claimpending")) {
+        replay_claims(index, get_member(data, "start_pack_asset_id").as_uint64(),
+            (uint32_t) get_member(data, "budget").as_uint64(), [](uint64_t, name) { return true; });
+
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+* Folds the traces file line by line, so that only a single trace is held in memory at a time
+*/
+static void fold_traces(const string &index_file_name, const string &traces_file_name, name contract_account) {
+    TRACE_INDEX index = read_index(index_file_name);
+
+    ifstream traces_file;
+    istream *input = &cin;
+    if (traces_file_name != "-") {
+        traces_file.open(traces_file_name);
+        if (!traces_file) {
+            throw runtime_error("Can't open " + traces_file_name);
+        }
+        input = &traces_file;
+    }
+
+    string line;
+    uint64_t line_number = 0;
+    uint64_t folded = 0;
+    while (getline(*input, line)) {
+        line_number++;
+        if (line.find_first_not_of(" \t\r") == string::npos) {
+            continue;
+        }
+        try {
+            folded += fold_trace(index, JsonParser(line).parse(), contract_account);
+        } catch (const exception &e) {
+            throw runtime_error(traces_file_name + ":" + to_string(line_number) + ": " + e.what());
+        }
+    }
+
+    write_index(index_file_name, index);
+    printf("Folded %llu of %llu traces into %s\n", (unsigned long long) folded, (unsigned long long) line_number,
+        index_file_name.c_str());
+}
+
+
+static void print_packs(const TRACE_INDEX &index, name collection_name) {
+    for (const auto &[pack_id, pack] : index.packs) {
+        if (pack.collection_name != collection_name) {
+            continue;
+        }
+        printf("{\"pack_id\":%llu,\"collection_name\":\"%s\",\"unlock_time\":%u,\"pack_template_id\":%d,"
+            "\"unbox_flags\":%u,\"num_rolls\":%zu}\n",
+            (unsigned long long) pack_id, pack.collection_name.to_string().c_str(), pack.unlock_time,
+            pack.pack_template_id, pack.unbox_flags, pack.roll_ids.size() - pack.deleted_roll_ids.size());
+    }
+}
+
+static void print_results(const TRACE_INDEX &index, uint64_t pack_id) {
+    for (const auto &[pack_asset_id, result] : index.results) {
+        if (result.pack_id != pack_id) {
+            continue;
+        }
+        printf("{\"pack_asset_id\":%llu,\"unboxer\":\"%s\",\"results\":[", (unsigned long long) pack_asset_id,
+            result.unboxer.to_string().c_str());
+        for (size_t i = 0; i < result.template_ids.size(); i++) {
+            printf("%s{\"origin_roll_id\":%llu,\"template_id\":%d,\"claimed\":%s}", i == 0 ? "" : ",",
+                (unsigned long long) result.origin_roll_ids[i], result.template_ids[i],
+                result.claimed[i] ? "true" : "false");
+        }
+        printf("]}\n");
+    }
+}
+
+/**
+* Prints the opened packs of the account that still have unclaimed results, and those whose results are not known yet
+*/
+static void print_pending(const TRACE_INDEX &index, name account) {
+    for (const auto &[pack_asset_id, result] : index.results) {
+        if (result.unboxer != account || result.unclaimed_count == 0) {
+            continue;
+        }
+        printf("{\"pack_asset_id\":%llu,\"pack_id\":%llu,\"results_known\":true,\"origin_roll_ids\":[",
+            (unsigned long long) pack_asset_id, (unsigned long long) result.pack_id);
+        bool first = true;
+        for (size_t i = 0; i < result.claimed.size(); i++) {
+            if (!result.claimed[i]) {
+                printf("%s%llu", first ? "" : ",", (unsigned long long) result.origin_roll_ids[i]);
+                first = false;
+            }
+        }
+        printf("]}\n");
+    }
+
+    for (const auto &[pack_asset_id, unboxer] : index.waiting_packs) {
+        if (unboxer == account) {
+            printf("{\"pack_asset_id\":%llu,\"results_known\":false}\n", (unsigned long long) pack_asset_id);
+        }
+    }
+}
+
+
+static void print_usage() {
+    fprintf(stderr,
+        "Usage:\n"
+        "    index_traces fold <index file> <traces.jsonl> [--contract NAME]\n"
+        "    index_traces packs <index file> <collection name>\n"
+        "    index_traces results <index file> <pack id>\n"
+        "    index_traces pending <index file> <account>\n");
+}
+
+int main(int argc, char **argv) {
+    vector <string> args(argv + 1, argv + argc);
+    name contract_account = name("atomicpacks");
+
+    auto contract_itr = std::find(args.begin(), args.end(), "--contract");
+    if (contract_itr != args.end()) {
+        if (contract_itr + 1 == args.end()) {
+            print_usage();
+            return 1;
+        }
+        contract_account = name(*(contract_itr + 1));
+        args.erase(contract_itr, contract_itr + 2);
+    }
+
+    if (args.size() != 3) {
+        print_usage();
+        return 1;
+    }
+
+    try {
+        const string &command = args[0];
+        if (command == "fold") {
+            fold_traces(args[1], args[2], contract_account);
+        } else if (command == "packs") {
+            print_packs(read_index(args[1]), name(args[2]));
+        } else if (command == "results") {
+            print_results(read_index(args[1]), stoull(args[2]));
+        } else if (command == "pending") {
+            print_pending(read_index(args[1]), name(args[2]));
+        } else {
+            print_usage();
+            return 1;
+        }
+    } catch (const exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
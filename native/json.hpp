@@ -0,0 +1,180 @@
+/*
+
+Parser for the JSON returned by the chain api and found in action traces, shared by the native tools
+
+*/
+
+#pragma once
+
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct JSON_VALUE {
+    enum TYPE { NONE, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    TYPE                              type = NONE;
+    std::string                            text;    //Raw number or unescaped string
+    std::vector <JSON_VALUE>               items;
+    std::vector <std::pair <std::string, JSON_VALUE>> members;
+
+    const JSON_VALUE *find(const std::string &key) const {
+        for (const auto &member : members) {
+            if (member.first == key) {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+
+    //64 bit integers can be returned as strings by the chain api
+    uint64_t as_uint64() const {
+        if (type != NUMBER && type != STRING) {
+            throw std::runtime_error("Expected a number");
+        }
+        return std::stoull(text);
+    }
+
+    int64_t as_int64() const {
+        if (type != NUMBER && type != STRING) {
+            throw std::runtime_error("Expected a number");
+        }
+        return std::stoll(text);
+    }
+};
+
+
+/**
+* Parser for the subset of JSON returned by the chain api, which is all of it except for unicode escapes
+*/
+class JsonParser {
+public:
+    explicit JsonParser(const std::string &input) : input(input), position(0) {}
+
+    JSON_VALUE parse() {
+        JSON_VALUE value = parse_value();
+        skip_whitespace();
+        if (position != input.size()) {
+            fail("Unexpected data after the end of the document");
+        }
+        return value;
+    }
+
+private:
+    JSON_VALUE parse_value() {
+        skip_whitespace();
+        if (position == input.size()) {
+            fail("Unexpected end of the document");
+        }
+
+        JSON_VALUE value;
+        char c = input[position];
+
+        if (c == '{') {
+            value.type = JSON_VALUE::OBJECT;
+            position++;
+            if (!consume('}')) {
+                do {
+                    skip_whitespace();
+                    std::string key = parse_string();
+                    expect(':');
+                    value.members.emplace_back(key, parse_value());
+                } while (consume(','));
+                expect('}');
+            }
+
+        } else if (c == '[') {
+            value.type = JSON_VALUE::ARRAY;
+            position++;
+            if (!consume(']')) {
+                do {
+                    value.items.push_back(parse_value());
+                } while (consume(','));
+                expect(']');
+            }
+
+        } else if (c == '"') {
+            value.type = JSON_VALUE::STRING;
+            value.text = parse_string();
+
+        } else if (input.compare(position, 4, "true") == 0 || input.compare(position, 5, "false") == 0) {
+            value.type = JSON_VALUE::BOOLEAN;
+            value.text = c == 't' ? "true" : "false";
+            position += value.text.size();
+
+        } else if (input.compare(position, 4, "null") == 0) {
+            position += 4;
+
+        } else {
+            value.type = JSON_VALUE::NUMBER;
+            size_t start = position;
+            while (position < input.size() && strchr("+-.0123456789eE", input[position]) != nullptr) {
+                position++;
+            }
+            if (position == start) {
+                fail("Unexpected character");
+            }
+            value.text = input.substr(start, position - start);
+        }
+
+        return value;
+    }
+
+    std::string parse_string() {
+        expect('"');
+        std::string result;
+        while (position < input.size() && input[position] != '"') {
+            char c = input[position++];
+            if (c == '\\') {
+                if (position == input.size()) {
+                    break;
+                }
+                char escaped = input[position++];
+                switch (escaped) {
+                    case 'n': result += '\n'; break;
+                    case 't': result += '\t'; break;
+                    case 'r': result += '\r'; break;
+                    case 'b': result += '\b'; break;
+                    case 'f': result += '\f'; break;
+                    case 'u': fail("Unicode escapes are not supported");
+                    default:  result += escaped;
+                }
+            } else {
+                result += c;
+            }
+        }
+        expect('"');
+        return result;
+    }
+
+    void skip_whitespace() {
+        while (position < input.size() && isspace((unsigned char) input[position])) {
+            position++;
+        }
+    }
+
+    bool consume(char c) {
+        skip_whitespace();
+        if (position < input.size() && input[position] == c) {
+            position++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) {
+            fail(std::string("Expected '") + c + "'");
+        }
+    }
+
+    [[noreturn]] void fail(const std::string &message) {
+        throw std::runtime_error("Invalid JSON at position " + std::to_string(position) + ": " + message);
+    }
+
+    const std::string &input;
+    size_t position;
+};
@@ -0,0 +1,493 @@
+/*
+
+Simulates unboxing a pack many times and compares the frequencies of the unboxed templates with the odds of its rolls
+
+The rolls are read from the packrolls table of the pack as returned by get_table_rows, either the whole response
+or only its rows array. The results are drawn exactly like receiverand does for packs with a packbundles row:
+the same alias tables, the same RandomnessProvider and the same order of the draws.
+Packs that were completed before bundles were introduced don't have alias tables. Their rolls are evaluated by
+summing up the odds instead, which has to be selected with --legacy, because the packrolls rows don't tell.
+
+Usage:
+    simulate_pack [--packs N] [--seed HEX] [--threads N] [--legacy] <packrolls.json>
+        Unboxes N packs (default 1000000). Pack i uses the seed sha256(seed || i), like packs opened with a
+        single transfer, and the seed is random if it is not specified
+        The packs are split over N threads (default the number of hardware threads), which gives the same results
+    simulate_pack --unbox HEX [--legacy] <packrolls.json>
+        Prints the results of unboxing a single pack with the seed HEX, e.g. the random value of a receiverand
+
+*/
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <eosio/crypto.hpp>
+
+#include <roll-outcomes.hpp>
+
+#include "json.hpp"
+
+using namespace std;
+using namespace eosio;
+
+#include "../src/randomness_provider.cpp"
+
+
+struct SIMULATED_ROLL {
+    uint64_t             roll_id;
+    uint32_t             count;
+    uint32_t             total_odds;
+    vector <OUTCOME>     outcomes;
+    vector <ALIAS_ENTRY> entries;
+};
+
+
+static vector <uint8_t> parse_bytes(const JSON_VALUE &value) {
+    vector <uint8_t> bytes = {};
+    if (value.type == JSON_VALUE::STRING) {
+        if (value.text.size() % 2 != 0) {
+            throw runtime_error("Invalid hex string");
+        }
+        for (size_t i = 0; i < value.text.size(); i += 2) {
+            bytes.push_back((uint8_t) stoul(value.text.substr(i, 2), nullptr, 16));
+        }
+    } else {
+        for (const JSON_VALUE &item : value.items) {
+            bytes.push_back((uint8_t) item.as_uint64());
+        }
+    }
+    return bytes;
+}
+
+
+/**
+* Reads the rolls of a pack and builds their alias tables, like completepack does
+*/
+static vector <SIMULATED_ROLL> read_rolls(const string &file_name) {
+    stringstream buffer;
+    if (file_name == "-") {
+        buffer << cin.rdbuf();
+    } else {
+        ifstream file(file_name);
+        if (!file) {
+            throw runtime_error("Can't open " + file_name);
+        }
+        buffer << file.rdbuf();
+    }
+
+    string input = buffer.str();
+    JSON_VALUE document = JsonParser(input).parse();
+    const JSON_VALUE *rows = document.type == JSON_VALUE::OBJECT ? document.find("rows") : &document;
+    if (rows == nullptr || rows->type != JSON_VALUE::ARRAY || rows->items.empty()) {
+        throw runtime_error("Expected a non empty array of packrolls rows");
+    }
+
+    vector <SIMULATED_ROLL> rolls = {};
+    for (const JSON_VALUE &row : rows->items) {
+        const JSON_VALUE *roll_id = row.find("roll_id");
+        const JSON_VALUE *total_odds = row.find("total_odds");
+        if (roll_id == nullptr || total_odds == nullptr) {
+            throw runtime_error("Each row needs a roll_id and total_odds");
+        }
+
+        SIMULATED_ROLL roll;
+        roll.roll_id = roll_id->as_uint64();
+        roll.count = 1;
+        roll.total_odds = (uint32_t) total_odds->as_uint64();
+
+        //Rolls added before counts were introduced don't have one
+        if (const JSON_VALUE *count = row.find("count")) {
+            roll.count = (uint32_t) count->as_uint64();
+        }
+
+        const JSON_VALUE *packed_outcomes = row.find("packed_outcomes");
+        vector <uint8_t> packed_bytes = packed_outcomes != nullptr ? parse_bytes(*packed_outcomes) : vector <uint8_t> {};
+        if (!packed_bytes.empty()) {
+            roll.outcomes = decode_outcomes(packed_bytes);
+        } else if (const JSON_VALUE *outcomes = row.find("outcomes")) {
+            for (const JSON_VALUE &outcome : outcomes->items) {
+                const JSON_VALUE *odds = outcome.find("odds");
+                const JSON_VALUE *template_id = outcome.find("template_id");
+                if (odds == nullptr || template_id == nullptr) {
+                    throw runtime_error("Each outcome needs odds and a template_id");
+                }
+                roll.outcomes.push_back({(uint32_t) odds->as_uint64(), (int32_t) template_id->as_int64()});
+            }
+        }
+
+        uint64_t summed_odds = 0;
+        for (const OUTCOME &outcome : roll.outcomes) {
+            summed_odds += outcome.odds;
+        }
+        if (roll.outcomes.empty() || summed_odds != roll.total_odds) {
+            throw runtime_error("The odds of roll " + to_string(roll.roll_id) + " don't add up to its total odds");
+        }
+
+        roll.entries = build_alias_table(roll.outcomes, roll.total_odds);
+        rolls.push_back(roll);
+    }
+
+    sort(rolls.begin(), rolls.end(), [](const SIMULATED_ROLL &a, const SIMULATED_ROLL &b) {
+        return a.roll_id < b.roll_id;
+    });
+    return rolls;
+}
+
+
+static checksum256 parse_seed(const string &hex) {
+    if (hex.size() != 64) {
+        throw runtime_error("A seed must be 64 hex characters");
+    }
+    array <uint8_t, 32> bytes;
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = (uint8_t) stoul(hex.substr(i * 2, 2), nullptr, 16);
+    }
+    return checksum256(bytes);
+}
+
+
+static string seed_to_hex(const checksum256 &seed) {
+    string hex;
+    char byte_hex[3];
+    for (uint8_t byte : seed.extract_as_byte_array()) {
+        snprintf(byte_hex, sizeof(byte_hex), "%02x", byte);
+        hex += byte_hex;
+    }
+    return hex;
+}
+
+
+/**
+* Draws of a pack in the order used by receiverand, each roll being drawn count times
+*
+* The alias tables of all rolls are stored as flat arrays, so that the outcomes of all draws are selected in a
+* separate loop without branches, which the compiler can vectorize (e.g. with -O3 -mavx2)
+*/
+class PackSimulator {
+public:
+    PackSimulator(const vector <SIMULATED_ROLL> &rolls, bool legacy) : rolls(rolls), legacy(legacy) {
+        for (size_t roll_index = 0; roll_index < rolls.size(); roll_index++) {
+            const SIMULATED_ROLL &roll = rolls[roll_index];
+
+            if (legacy) {
+                //The contract draws each packrolls row once, counts did not exist yet for these packs
+                if (roll.count != 1) {
+                    throw runtime_error("Roll " + to_string(roll.roll_id) + " has a count above 1, so the pack has a bundle");
+                }
+                draws.push_back({roll_index, roll.total_odds, roll.roll_id});
+                bounds.push_back(roll.total_odds);
+                continue;
+            }
+
+            for (const ALIAS_ENTRY &entry : roll.entries) {
+                thresholds.push_back(entry.threshold);
+                template_ids.push_back(entry.template_id);
+                alias_template_ids.push_back(entry.alias_template_id);
+            }
+            for (uint64_t origin_roll_id = roll.roll_id; origin_roll_id < roll.roll_id + roll.count; origin_roll_id++) {
+                draws.push_back({thresholds.size() - roll.entries.size(), roll.total_odds, origin_roll_id});
+                bounds.push_back(roll.entries.size() * (uint64_t) roll.total_odds);
+            }
+        }
+
+        entry_indices.resize(draws.size());
+        remainders.resize(draws.size());
+    }
+
+    size_t get_num_draws() const { return draws.size(); }
+
+    uint64_t get_origin_roll_id(size_t draw) const { return draws[draw].origin_roll_id; }
+
+    void unbox(const checksum256 &seed, vector <int32_t> &result_template_ids) {
+        RandomnessProvider randomness_provider(seed);
+        randomness_provider.fill(rands, bounds);
+        result_template_ids.resize(draws.size());
+
+        if (legacy) {
+            for (size_t i = 0; i < draws.size(); i++) {
+                uint32_t summed_odds = 0;
+                for (const OUTCOME &outcome : rolls[draws[i].offset].outcomes) {
+                    summed_odds += outcome.odds;
+                    if (summed_odds > rands[i]) {
+                        result_template_ids[i] = outcome.template_id;
+                        break;
+                    }
+                }
+            }
+            return;
+        }
+
+        //Same selection as get_alias_outcome, split into the divisions and the selection of the outcomes
+        for (size_t i = 0; i < draws.size(); i++) {
+            entry_indices[i] = (uint32_t) (draws[i].offset + rands[i] / draws[i].total_odds);
+            remainders[i] = (uint32_t) (rands[i] % draws[i].total_odds);
+        }
+
+        const uint32_t *entry_index_data = entry_indices.data();
+        const uint32_t *remainder_data = remainders.data();
+        const uint32_t *threshold_data = thresholds.data();
+        const int32_t *template_id_data = template_ids.data();
+        const int32_t *alias_template_id_data = alias_template_ids.data();
+        int32_t *result_data = result_template_ids.data();
+
+        for (size_t i = 0; i < draws.size(); i++) {
+            uint32_t entry_index = entry_index_data[i];
+            result_data[i] = remainder_data[i] < threshold_data[entry_index]
+                ? template_id_data[entry_index]
+                : alias_template_id_data[entry_index];
+        }
+    }
+
+private:
+    struct DRAW {
+        size_t   offset;          //Of the alias table in the flat arrays, or the index of the roll for legacy packs
+        uint32_t total_odds;
+        uint64_t origin_roll_id;
+    };
+
+    const vector <SIMULATED_ROLL> &rolls;
+    bool legacy;
+
+    vector <DRAW>     draws;
+    vector <uint64_t> bounds;
+    vector <uint64_t> rands;
+
+    vector <uint32_t> thresholds;
+    vector <int32_t>  template_ids;
+    vector <int32_t>  alias_template_ids;
+    vector <uint32_t> entry_indices;
+    vector <uint32_t> remainders;
+};
+
+
+struct TEMPLATE_ODDS {
+    double expected_count       = 0; //Per pack, from the odds
+    double expected_probability = 0; //Of at least one per pack, from the odds
+};
+
+
+struct TEMPLATE_COUNTS {
+    vector <uint64_t> total_counts;
+    vector <double>   squared_count_sums;
+    vector <uint64_t> packs_with_template;
+
+    explicit TEMPLATE_COUNTS(size_t num_templates) :
+        total_counts(num_templates), squared_count_sums(num_templates), packs_with_template(num_templates) {}
+};
+
+
+/**
+* Unboxes the packs with the indices [first_pack, end_pack) and adds the counts of their results
+*/
+static void simulate_packs(
+    const vector <SIMULATED_ROLL> &rolls,
+    bool legacy,
+    const checksum256 &seed,
+    uint64_t first_pack,
+    uint64_t end_pack,
+    const map <int32_t, size_t> &template_indices,
+    TEMPLATE_COUNTS &counts
+) {
+    //Dense lookup so that counting the results of a pack doesn't need a map lookup for each draw
+    int32_t min_template_id = template_indices.begin()->first;
+    vector <size_t> dense_indices(template_indices.rbegin()->first - min_template_id + 1);
+    for (const auto &[template_id, index] : template_indices) {
+        dense_indices[template_id - min_template_id] = index;
+    }
+
+    PackSimulator simulator(rolls, legacy);
+    vector <int32_t> result_template_ids;
+    vector <uint32_t> pack_counts(template_indices.size());
+
+    //Same seed derivation as for packs opened with a single transfer, with i taking the place of the pack asset id
+    array <uint8_t, 40> seed_data;
+    memcpy(seed_data.data(), seed.extract_as_byte_array().data(), 32);
+
+    for (uint64_t i = first_pack; i < end_pack; i++) {
+        memcpy(seed_data.data() + 32, &i, sizeof(i));
+        simulator.unbox(eosio::sha256((char *) seed_data.data(), seed_data.size()), result_template_ids);
+
+        for (int32_t template_id : result_template_ids) {
+            pack_counts[dense_indices[template_id - min_template_id]]++;
+        }
+        for (size_t t = 0; t < pack_counts.size(); t++) {
+            counts.total_counts[t] += pack_counts[t];
+            counts.squared_count_sums[t] += (double) pack_counts[t] * pack_counts[t];
+            counts.packs_with_template[t] += pack_counts[t] != 0;
+            pack_counts[t] = 0;
+        }
+    }
+}
+
+
+static void run_simulation(
+    const vector <SIMULATED_ROLL> &rolls,
+    bool legacy,
+    uint64_t num_packs,
+    size_t num_threads,
+    const checksum256 &seed
+) {
+    map <int32_t, TEMPLATE_ODDS> template_odds = {};
+    map <int32_t, double> probability_of_none = {};
+    for (const SIMULATED_ROLL &roll : rolls) {
+        for (const OUTCOME &outcome : roll.outcomes) {
+            double probability = (double) outcome.odds / roll.total_odds;
+            template_odds[outcome.template_id].expected_count += roll.count * probability;
+            auto none_itr = probability_of_none.emplace(outcome.template_id, 1.0).first;
+            none_itr->second *= pow(1 - probability, roll.count);
+        }
+    }
+    for (auto &[template_id, odds] : template_odds) {
+        odds.expected_probability = 1 - probability_of_none[template_id];
+    }
+
+    vector <int32_t> template_ids = {};
+    map <int32_t, size_t> template_indices = {};
+    for (const auto &[template_id, odds] : template_odds) {
+        template_indices[template_id] = template_ids.size();
+        template_ids.push_back(template_id);
+    }
+
+    //Also checks that the rolls can be simulated before the workers are started
+    size_t num_draws = PackSimulator(rolls, legacy).get_num_draws();
+
+    //Each worker simulates a contiguous range of pack indices, and the sums are merged once all are done
+    size_t num_workers = (size_t) min <uint64_t> (num_threads, num_packs);
+    vector <TEMPLATE_COUNTS> worker_counts(num_workers, TEMPLATE_COUNTS(template_ids.size()));
+    vector <thread> workers = {};
+
+    for (size_t w = 0; w < num_workers; w++) {
+        uint64_t first_pack = num_packs * w / num_workers;
+        uint64_t end_pack = num_packs * (w + 1) / num_workers;
+        workers.emplace_back([&, w, first_pack, end_pack]() {
+            simulate_packs(rolls, legacy, seed, first_pack, end_pack, template_indices, worker_counts[w]);
+        });
+    }
+
+    TEMPLATE_COUNTS counts(template_ids.size());
+    for (size_t w = 0; w < num_workers; w++) {
+        workers[w].join();
+        for (size_t t = 0; t < template_ids.size(); t++) {
+            counts.total_counts[t] += worker_counts[w].total_counts[t];
+            counts.squared_count_sums[t] += worker_counts[w].squared_count_sums[t];
+            counts.packs_with_template[t] += worker_counts[w].packs_with_template[t];
+        }
+    }
+
+    printf("Simulated %llu packs with %zu rolls each, seed %s\n\n",
+        (unsigned long long) num_packs, num_draws, seed_to_hex(seed).c_str());
+    printf("%12s  %14s  %14s  %12s  %8s  %12s  %12s\n",
+        "template_id", "expected/pack", "observed/pack", "95% ci", "z", "expected p", "observed p");
+
+    for (size_t t = 0; t < template_ids.size(); t++) {
+        const TEMPLATE_ODDS &odds = template_odds[template_ids[t]];
+        double mean = (double) counts.total_counts[t] / num_packs;
+        double variance = max(0.0, counts.squared_count_sums[t] / num_packs - mean * mean);
+        double standard_error = sqrt(variance / num_packs);
+        double z = standard_error > 0 ? (mean - odds.expected_count) / standard_error : 0;
+
+        printf("%12d  %14.8f  %14.8f  %12.8f  %8.3f  %12.8f  %12.8f\n",
+            template_ids[t], odds.expected_count, mean, 1.96 * standard_error, z,
+            odds.expected_probability, (double) counts.packs_with_template[t] / num_packs);
+    }
+}
+
+
+static void print_unbox(const vector <SIMULATED_ROLL> &rolls, bool legacy, const checksum256 &seed) {
+    PackSimulator simulator(rolls, legacy);
+    vector <int32_t> result_template_ids;
+    simulator.unbox(seed, result_template_ids);
+
+    printf("%14s  %12s\n", "origin_roll_id", "template_id");
+    for (size_t i = 0; i < result_template_ids.size(); i++) {
+        printf("%14llu  %12d\n", (unsigned long long) simulator.get_origin_roll_id(i), result_template_ids[i]);
+    }
+}
+
+
+static void print_usage() {
+    fprintf(stderr,
+        "Usage: simulate_pack [--packs N] [--seed HEX] [--threads N] [--legacy] <packrolls.json>\n"
+        "       simulate_pack --unbox HEX [--legacy] <packrolls.json>\n"
+        "The packrolls JSON is the response of get_table_rows (or its rows), - reads it from stdin\n"
+        "--legacy simulates packs that were completed before bundles were introduced\n");
+}
+
+
+int main(int argc, char **argv) {
+    uint64_t num_packs = 1000000;
+    string seed_hex;
+    string unbox_seed_hex;
+    size_t num_threads = max(1u, thread::hardware_concurrency());
+    bool legacy = false;
+    string file_name;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--legacy") {
+            legacy = true;
+        } else if ((arg == "--packs" || arg == "--seed" || arg == "--unbox" || arg == "--threads") && i + 1 < argc) {
+            string value = argv[++i];
+            if (arg == "--packs") {
+                num_packs = stoull(value);
+            } else if (arg == "--threads") {
+                num_threads = stoull(value);
+            } else if (arg == "--seed") {
+                seed_hex = value;
+            } else {
+                unbox_seed_hex = value;
+            }
+        } else if (file_name.empty() && (arg == "-" || arg[0] != '-')) {
+            file_name = arg;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (file_name.empty() || num_packs == 0 || num_threads == 0) {
+        print_usage();
+        return 1;
+    }
+
+    try {
+        vector <SIMULATED_ROLL> rolls = read_rolls(file_name);
+
+        if (!unbox_seed_hex.empty()) {
+            print_unbox(rolls, legacy, parse_seed(unbox_seed_hex));
+            return 0;
+        }
+
+        checksum256 seed;
+        if (!seed_hex.empty()) {
+            seed = parse_seed(seed_hex);
+        } else {
+            random_device device;
+            array <uint8_t, 32> bytes;
+            for (uint8_t &byte : bytes) {
+                byte = (uint8_t) device();
+            }
+            seed = checksum256(bytes);
+        }
+
+        run_simulation(rolls, legacy, num_packs, num_threads, seed);
+
+    } catch (const exception &e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
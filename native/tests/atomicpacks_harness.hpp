@@ -0,0 +1,476 @@
+/*
+
+Runs the actions of the atomicpacks contract natively, against the stand-in for the chain in the eosio directory.
+Shared by the contract tests and the contract benchmarks.
+
+Each action is run like on chain: the contract is constructed, the action is called and the contract is destructed,
+which settles its RAM ledger. If any of this throws, all table changes of the action are reverted.
+The inline actions that the contract sends are then executed by minimal fakes of atomicassets and the rng oracle,
+which only write the rows that the RAM accounting of the contract depends on:
+- atomicassets::mintasset emplaces an asset row without any data, paid by the minter
+- atomicassets::burnasset erases the asset row
+- orng.wax::requestrand emplaces a signvals row and a jobs row, paid by the caller
+The actions that the contract sends to itself (the log actions) are only recorded.
+
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+
+#include "../../src/atomicpacks.cpp"
+
+namespace harness {
+
+    using eosio::native::chain;
+    using eosio::native::chain_state;
+    using eosio::native::DB_OPERATION;
+    using eosio::native::SENT_ACTION;
+    using eosio::native::STORED_ROW;
+    using eosio::native::STORED_TABLE;
+    using eosio::native::TABLE_ID;
+
+    static constexpr name CONTRACT_ACCOUNT = name("atomicpacks");
+    static constexpr name COLLECTION_NAME  = name("testcol");
+    static constexpr name AUTHOR           = name("author");
+    static constexpr name PACK_MINTER      = name("packminter");
+    static constexpr name SCHEMA_NAME      = name("cards");
+    static constexpr name OTHER_DAPP       = name("otherdapp");
+
+    //Templates created by setup_chain. Each pack needs its own burnable and transferable template
+    static constexpr int32_t FIRST_PACK_TEMPLATE_ID    = 1;
+    static constexpr int32_t NUM_PACK_TEMPLATES        = 99;
+    static constexpr int32_t FIRST_OUTCOME_TEMPLATE_ID = 100;
+    static constexpr int32_t NUM_OUTCOME_TEMPLATES     = 10;
+
+    static constexpr uint64_t FIRST_ASSET_ID = 1099511627776; //2^40, like the atomicassets asset counter
+
+
+    struct ACTION_RESULT {
+        string                                      error;         //Empty if the action succeeded
+        vector <SENT_ACTION>                        sent_actions;  //Inline actions sent by the contract
+        vector <DB_OPERATION>                       db_operations; //Of the action, without those of the fakes
+        vector <pair <TABLE_ID, uint64_t>>          db_reads;      //Of the action, without those of the fakes
+        map <uint64_t, int64_t>                     ram_deltas;    //Including the inline actions
+
+        bool succeeded() const { return error.empty(); }
+    };
+
+    //The jobs table is not part of the rng oracle interface, its rows have 4 x 8 bytes of data
+    struct ORNG_JOB {
+        uint64_t id;
+        uint64_t assoc_id;
+        uint64_t signing_value;
+        name     caller;
+
+        uint64_t primary_key() const { return id; }
+    };
+
+    typedef multi_index <name("jobs"), ORNG_JOB> orng_jobs_t;
+
+    struct RAMBALANCE_ROW {
+        name    collection_name;
+        int64_t byte_balance;
+    };
+
+    //State of the fakes, reverted together with the chain state
+    struct HARNESS_STATE {
+        uint64_t                 next_asset_id         = FIRST_ASSET_ID;
+        uint64_t                 next_job_id           = 1;
+        int32_t                  next_pack_template_id = FIRST_PACK_TEMPLATE_ID;
+        map <uint64_t, uint64_t> pending_jobs          = {}; //Job id of each unanswered randomness request by assoc id
+        bool                     revert_on_failure     = true; //Benchmarks turn this off to not copy the chain state
+    };
+
+    inline HARNESS_STATE &harness_state() {
+        static HARNESS_STATE state;
+        return state;
+    }
+
+
+    [[noreturn]] inline void fail_setup(const string &what, const string &error) {
+        fprintf(stderr, "harness: %s failed: %s\n", what.c_str(), error.c_str());
+        exit(1);
+    }
+
+    /**
+    * Runs the function with the receiver set to the specified account, so that it can write the tables of that account
+    */
+    template <typename FUNCTION>
+    void with_receiver(name receiver, FUNCTION &&function) {
+        name previous_receiver = chain().receiver;
+        chain().receiver = receiver;
+        try {
+            function();
+        } catch (...) {
+            chain().receiver = previous_receiver;
+            throw;
+        }
+        chain().receiver = previous_receiver;
+    }
+
+
+    /**
+    * Executes an inline action sent by the contract with the fake of its receiver
+    * Actions to other accounts are only recorded
+    */
+    inline void execute_inline_action(const SENT_ACTION &sent_action) {
+        if (sent_action.account == atomicassets::ATOMICASSETS_ACCOUNT && sent_action.action_name == name("mintasset")) {
+            auto data = unpack <std::tuple <
+                name, name, name, int32_t, name,
+                atomicassets::ATTRIBUTE_MAP, atomicassets::ATTRIBUTE_MAP, vector <asset>
+            >> (sent_action.data);
+            name authorized_minter = std::get <0> (data);
+            name new_asset_owner = std::get <4> (data);
+
+            with_receiver(atomicassets::ATOMICASSETS_ACCOUNT, [&]() {
+                atomicassets::get_assets(new_asset_owner).emplace(authorized_minter, [&](auto &_asset) {
+                    _asset.asset_id = harness_state().next_asset_id++;
+                    _asset.collection_name = std::get <1> (data);
+                    _asset.schema_name = std::get <2> (data);
+                    _asset.template_id = std::get <3> (data);
+                    _asset.ram_payer = authorized_minter;
+                });
+            });
+
+        } else if (sent_action.account == atomicassets::ATOMICASSETS_ACCOUNT
+            && sent_action.action_name == name("burnasset")) {
+            auto data = unpack <std::tuple <name, uint64_t>> (sent_action.data);
+
+            with_receiver(atomicassets::ATOMICASSETS_ACCOUNT, [&]() {
+                atomicassets::assets_t owner_assets = atomicassets::get_assets(std::get <0> (data));
+                owner_assets.erase(owner_assets.require_find(std::get <1> (data), "No asset with this id exists"));
+            });
+
+        } else if (sent_action.account == orng::ORNG_CONTRACT && sent_action.action_name == name("requestrand")) {
+            auto data = unpack <std::tuple <uint64_t, uint64_t, name>> (sent_action.data);
+            uint64_t assoc_id = std::get <0> (data);
+            uint64_t signing_value = std::get <1> (data);
+            name caller = std::get <2> (data);
+
+            with_receiver(orng::ORNG_CONTRACT, [&]() {
+                check(orng::signvals.find(signing_value) == orng::signvals.end(), "Signing value already used");
+                orng::signvals.emplace(caller, [&](auto &_signval) {
+                    _signval.signing_value = signing_value;
+                });
+
+                uint64_t job_id = harness_state().next_job_id++;
+                orng_jobs_t(orng::ORNG_CONTRACT, orng::ORNG_CONTRACT.value).emplace(caller, [&](auto &_job) {
+                    _job.id = job_id;
+                    _job.assoc_id = assoc_id;
+                    _job.signing_value = signing_value;
+                    _job.caller = caller;
+                });
+                harness_state().pending_jobs[assoc_id] = job_id;
+            });
+        }
+    }
+
+
+    /**
+    * Runs an action of the contract with the specified authorizations, followed by the inline actions it sent
+    * The call receives the contract and calls the action on it
+    */
+    template <typename CALL>
+    ACTION_RESULT run_action(name first_receiver, const vector <name> &authorizations, CALL &&call) {
+        chain_state &state = chain();
+
+        struct SNAPSHOT {
+            map <TABLE_ID, STORED_TABLE> tables;
+            map <uint64_t, int64_t>      ram_usage;
+            HARNESS_STATE                harness;
+        } snapshot;
+        if (harness_state().revert_on_failure) {
+            snapshot = {state.tables, state.ram_usage, harness_state()};
+        }
+        map <uint64_t, int64_t> ram_before = state.ram_usage;
+
+        state.receiver = CONTRACT_ACCOUNT;
+        state.authorizations.clear();
+        for (name authorization : authorizations) {
+            state.authorizations.insert(authorization.value);
+        }
+        state.sent_actions.clear();
+        state.db_operations.clear();
+        state.db_reads.clear();
+        state.db_iterators.clear();
+
+        ACTION_RESULT result;
+        try {
+            {
+                atomicpacks contract(CONTRACT_ACCOUNT, first_receiver, datastream <const char *> (nullptr, 0));
+                call(contract);
+            }
+            result.sent_actions = state.sent_actions;
+            result.db_operations = state.db_operations;
+            result.db_reads = state.db_reads;
+
+            for (const SENT_ACTION &sent_action : result.sent_actions) {
+                execute_inline_action(sent_action);
+            }
+        } catch (const std::exception &e) {
+            result.error = e.what();
+            if (harness_state().revert_on_failure) {
+                state.tables = std::move(snapshot.tables);
+                state.ram_usage = std::move(snapshot.ram_usage);
+                harness_state() = snapshot.harness;
+            }
+        }
+        state.receiver = name();
+
+        for (const auto &[account, bytes] : state.ram_usage) {
+            int64_t delta = bytes - (ram_before.count(account) ? ram_before[account] : 0);
+            if (delta != 0) {
+                result.ram_deltas[account] = delta;
+            }
+        }
+        for (const auto &[account, bytes] : ram_before) {
+            if (state.ram_usage.count(account) == 0 && bytes != 0) {
+                result.ram_deltas[account] = -bytes;
+            }
+        }
+        return result;
+    }
+
+    inline ACTION_RESULT run_action(const vector <name> &authorizations, std::function <void(atomicpacks &)> call) {
+        return run_action(CONTRACT_ACCOUNT, authorizations, call);
+    }
+
+    inline void require_success(const ACTION_RESULT &result, const string &what) {
+        if (!result.succeeded()) {
+            fail_setup(what, result.error);
+        }
+    }
+
+
+    //Reading tables
+
+    inline const map <uint64_t, STORED_ROW> &get_rows(name code, uint64_t scope, name table) {
+        return *chain().get_rows({code.value, scope, table.value});
+    }
+
+    template <typename T>
+    vector <T> read_rows(name code, uint64_t scope, name table) {
+        vector <T> rows = {};
+        for (const auto &[primary_key, row] : get_rows(code, scope, table)) {
+            rows.push_back(unpack <T> (row.data));
+        }
+        return rows;
+    }
+
+    inline int64_t get_collection_ram_balance(name collection_name = COLLECTION_NAME) {
+        const STORED_ROW *row = chain().find_row(
+            {CONTRACT_ACCOUNT.value, CONTRACT_ACCOUNT.value, name("rambalances").value}, collection_name.value);
+        return row != nullptr ? unpack <RAMBALANCE_ROW> (row->data).byte_balance : 0;
+    }
+
+    /**
+    * Returns the RAM billed to the contract that the collections pay for through their RAM balances
+    * Not included are the tables in the contract's own scope and the config and ramrefunds rows, which are
+    * shared by all collections and paid by the contract itself
+    */
+    inline int64_t get_collection_paid_bytes() {
+        int64_t bytes = chain().get_ram_usage(CONTRACT_ACCOUNT)
+            - chain().get_table_overhead_bytes(CONTRACT_ACCOUNT, CONTRACT_ACCOUNT.value, CONTRACT_ACCOUNT);
+
+        for (name table : {name("config"), name("ramrefunds"), name("identifier")}) {
+            for (const auto &[primary_key, row] : get_rows(CONTRACT_ACCOUNT, CONTRACT_ACCOUNT.value, table)) {
+                bytes -= eosio::native::ROW_OVERHEAD_BYTES + (int64_t) row.data.size();
+            }
+        }
+        return bytes;
+    }
+
+    inline vector <SENT_ACTION> get_sent_actions(const ACTION_RESULT &result, name account, name action_name) {
+        vector <SENT_ACTION> sent_actions = {};
+        for (const SENT_ACTION &sent_action : result.sent_actions) {
+            if (sent_action.account == account && sent_action.action_name == action_name) {
+                sent_actions.push_back(sent_action);
+            }
+        }
+        return sent_actions;
+    }
+
+
+    //Setting up the chain
+
+    /**
+    * Resets the chain to a collection that has the contract as an authorized account, the pack and outcome templates
+    * and the specified RAM balance, and to rng oracle tables that have already been used by another dapp
+    */
+    inline void setup_chain(int64_t collection_ram_bytes) {
+        //The versions keep counting up, so that objects cached by the global tables of the interfaces are reloaded
+        uint64_t next_version = chain().next_version;
+        chain() = chain_state();
+        chain().next_version = next_version;
+
+        bool revert_on_failure = harness_state().revert_on_failure;
+        harness_state() = HARNESS_STATE();
+        harness_state().revert_on_failure = revert_on_failure;
+
+        with_receiver(atomicassets::ATOMICASSETS_ACCOUNT, [&]() {
+            atomicassets::collections.emplace(AUTHOR, [&](auto &_collection) {
+                _collection.collection_name = COLLECTION_NAME;
+                _collection.author = AUTHOR;
+                _collection.allow_notify = true;
+                _collection.authorized_accounts = {AUTHOR, CONTRACT_ACCOUNT};
+                _collection.market_fee = 0.05;
+            });
+
+            atomicassets::templates_t col_templates = atomicassets::get_templates(COLLECTION_NAME);
+            auto add_template = [&](int32_t template_id) {
+                col_templates.emplace(AUTHOR, [&](auto &_template) {
+                    _template.template_id = template_id;
+                    _template.schema_name = SCHEMA_NAME;
+                    _template.transferable = true;
+                    _template.burnable = true;
+                    _template.max_supply = 0;
+                    _template.issued_supply = 0;
+                });
+            };
+            for (int32_t i = 0; i < NUM_PACK_TEMPLATES; i++) {
+                add_template(FIRST_PACK_TEMPLATE_ID + i);
+            }
+            for (int32_t i = 0; i < NUM_OUTCOME_TEMPLATES; i++) {
+                add_template(FIRST_OUTCOME_TEMPLATE_ID + i);
+            }
+        });
+
+        //The rng oracle tables already exist on chain, so their table overhead is not paid by the contract
+        with_receiver(orng::ORNG_CONTRACT, [&]() {
+            orng::signvals.emplace(OTHER_DAPP, [&](auto &_signval) {
+                _signval.signing_value = 0;
+            });
+            orng_jobs_t(orng::ORNG_CONTRACT, orng::ORNG_CONTRACT.value).emplace(OTHER_DAPP, [&](auto &_job) {
+                _job.id = 0;
+                _job.caller = OTHER_DAPP;
+            });
+        });
+
+        require_success(run_action({CONTRACT_ACCOUNT}, [&](atomicpacks &contract) {
+            contract.refundram(name("deposit"), 0, 1, {{COLLECTION_NAME, (uint64_t) collection_ram_bytes}});
+        }), "depositing the collection RAM");
+    }
+
+
+    struct TEST_PACK {
+        uint64_t pack_id;
+        int32_t  pack_template_id;
+    };
+
+    /**
+    * Announces a pack and returns its pack id
+    */
+    inline uint64_t announce_pack() {
+        ACTION_RESULT result = run_action({AUTHOR}, [&](atomicpacks &contract) {
+            contract.announcepack(AUTHOR, COLLECTION_NAME, 0, "");
+        });
+        require_success(result, "announcepack");
+        return std::get <0> (unpack <std::tuple <uint64_t, name, uint32_t>> (
+            get_sent_actions(result, CONTRACT_ACCOUNT, name("lognewpack")).at(0).data));
+    }
+
+    /**
+    * Announces, fills and completes a pack with the specified rolls and unbox flags
+    */
+    inline TEST_PACK create_pack(const vector <atomicpacks::ROLL_DATA> &rolls, uint32_t unbox_flags) {
+        TEST_PACK pack = {.pack_id = announce_pack(), .pack_template_id = harness_state().next_pack_template_id++};
+
+        require_success(run_action({AUTHOR}, [&](atomicpacks &contract) {
+            contract.addpackrolls(AUTHOR, pack.pack_id, rolls);
+        }), "addpackrolls");
+
+        require_success(run_action({AUTHOR}, [&](atomicpacks &contract) {
+            binary_extension <uint32_t> flags;
+            flags.emplace(unbox_flags);
+            contract.completepack(AUTHOR, pack.pack_id, pack.pack_template_id, flags);
+        }), "completepack");
+
+        return pack;
+    }
+
+
+    struct OPENED_PACKS {
+        vector <uint64_t> pack_asset_ids;
+        ACTION_RESULT     result;
+    };
+
+    /**
+    * Mints pack assets to the contract and notifies it of their transfer, which opens them
+    * The transfer itself is not reverted if the contract rejects it
+    */
+    inline OPENED_PACKS open_packs(const TEST_PACK &pack, uint32_t num_packs, name unboxer) {
+        OPENED_PACKS opened = {};
+
+        with_receiver(atomicassets::ATOMICASSETS_ACCOUNT, [&]() {
+            atomicassets::assets_t contract_assets = atomicassets::get_assets(CONTRACT_ACCOUNT);
+            for (uint32_t i = 0; i < num_packs; i++) {
+                uint64_t asset_id = harness_state().next_asset_id++;
+                contract_assets.emplace(PACK_MINTER, [&](auto &_asset) {
+                    _asset.asset_id = asset_id;
+                    _asset.collection_name = COLLECTION_NAME;
+                    _asset.schema_name = SCHEMA_NAME;
+                    _asset.template_id = pack.pack_template_id;
+                    _asset.ram_payer = PACK_MINTER;
+                });
+                opened.pack_asset_ids.push_back(asset_id);
+            }
+        });
+
+        opened.result = run_action(atomicassets::ATOMICASSETS_ACCOUNT, {unboxer}, [&](atomicpacks &contract) {
+            contract.receive_asset_transfer(unboxer, CONTRACT_ACCOUNT, opened.pack_asset_ids, "unbox");
+        });
+        return opened;
+    }
+
+
+    inline checksum256 make_random_value(uint64_t index) {
+        return eosio::sha256((const char *) &index, sizeof(index));
+    }
+
+    /**
+    * Returns the seed of a pack that was opened together with other packs, like receiverand derives it
+    */
+    inline checksum256 get_batch_seed(const checksum256 &random_value, uint64_t pack_asset_id) {
+        array <uint8_t, 40> seed_data;
+        memcpy(seed_data.data(), random_value.extract_as_byte_array().data(), 32);
+        memcpy(seed_data.data() + 32, &pack_asset_id, sizeof(pack_asset_id));
+        return eosio::sha256((const char *) seed_data.data(), seed_data.size());
+    }
+
+    /**
+    * Answers the randomness request of the assoc id like the rng oracle does:
+    * The jobs row is erased and receiverand is called with the authorization of the rng oracle
+    */
+    inline ACTION_RESULT deliver_randomness(uint64_t assoc_id, const checksum256 &random_value) {
+        auto job_itr = harness_state().pending_jobs.find(assoc_id);
+        if (job_itr == harness_state().pending_jobs.end()) {
+            fail_setup("deliver_randomness", "no pending request for the assoc id " + to_string(assoc_id));
+        }
+        uint64_t job_id = job_itr->second;
+
+        return run_action({orng::ORNG_CONTRACT}, [&](atomicpacks &contract) {
+            with_receiver(orng::ORNG_CONTRACT, [&]() {
+                orng_jobs_t jobs = orng_jobs_t(orng::ORNG_CONTRACT, orng::ORNG_CONTRACT.value);
+                jobs.erase(jobs.require_find(job_id));
+            });
+            harness_state().pending_jobs.erase(assoc_id);
+
+            contract.receiverand(assoc_id, random_value);
+        });
+    }
+
+    /**
+    * Returns the results of a pack for the seed, drawn at once with the read only previewunbox action
+    */
+    inline vector <atomicpacks::UNBOX_RESULT> preview_results(uint64_t pack_id, const checksum256 &seed) {
+        vector <atomicpacks::UNBOX_RESULT> results = {};
+        require_success(run_action({}, [&](atomicpacks &contract) {
+            results = contract.previewunbox(pack_id, seed);
+        }), "previewunbox");
+        return results;
+    }
+}
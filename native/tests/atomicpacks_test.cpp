@@ -0,0 +1,693 @@
+/*
+
+Runs the unbox lifecycle of the contract natively with every combination of unbox flags and checks the RAM accounting:
+The bytes reserved from the collection's balance when opening packs need to equal the bytes refunded plus the bytes
+that stay in use (the minted assets, their scope and the signvals row of the rng oracle), and the balance may never
+cover less than the RAM that is billed to the contract for the collection.
+
+The row and table sizes are billed with the overheads of the cost model in atomicpacks.hpp, see eosio/chain.hpp.
+The tables in the contract's own scope are shared by all collections and paid by the contract, so they are not
+part of the accounting.
+
+*/
+
+#include "testing.hpp"
+#include "atomicpacks_harness.hpp"
+
+using namespace harness;
+
+static constexpr name UNBOXER  = name("unboxer");
+static constexpr name STRANGER = name("stranger");
+
+static constexpr int64_t COLLECTION_RAM_BYTES = 100000000;
+
+//Rows of the contract tables, as clients read them
+struct UNBOXPACK_ROW {
+    uint64_t                                   pack_asset_id;
+    uint64_t                                   pack_id;
+    name                                       unboxer;
+    binary_extension <atomicpacks::UNBOX_SEED> unbox_seed;
+};
+
+struct UNBOXCURSOR_ROW {
+    uint64_t    pack_asset_id;
+    checksum256 seed;
+    uint64_t    rand_position;
+    uint64_t    next_roll_id;
+};
+
+enum CLAIM_METHOD {
+    CLAIM_UNBOXED,
+    CLAIM_ALL,
+    CLAIM_PENDING
+};
+
+static const char *CLAIM_METHOD_NAMES[] = {"claimunboxed", "claimall", "claimpending"};
+
+
+static atomicpacks::ROLL_DATA make_roll(uint32_t count) {
+    return {
+        .outcomes = {
+            {.odds = 50, .template_id = FIRST_OUTCOME_TEMPLATE_ID},
+            {.odds = 30, .template_id = FIRST_OUTCOME_TEMPLATE_ID + 1},
+            {.odds = 15, .template_id = -1},
+            {.odds = 5, .template_id = FIRST_OUTCOME_TEMPLATE_ID + 2}
+        },
+        .total_odds = 100,
+        .count = count
+    };
+}
+
+static vector <atomicpacks::ROLL_DATA> make_rolls(const vector <uint32_t> &counts) {
+    vector <atomicpacks::ROLL_DATA> rolls = {};
+    for (uint32_t count : counts) {
+        rolls.push_back(make_roll(count));
+    }
+    return rolls;
+}
+
+static int64_t get_varint_size(uint64_t value) {
+    int64_t size = 1;
+    for (; value >= 0x80; value >>= 7) {
+        size++;
+    }
+    return size;
+}
+
+/**
+* The bytes reserved for each opened pack, derived independently of the contract from the row layouts
+*/
+static int64_t get_expected_reserved_bytes(uint32_t flags, uint64_t roll_count) {
+    int64_t reserved = 0;
+    if (flags & UNBOX_FLAG_DIRECT_MINT) {
+        //Asset scope and one asset row (112 + 39 bytes) per roll
+        reserved = 112 + (int64_t) roll_count * 151;
+    } else if (flags & UNBOX_FLAG_PACKED_RESULTS) {
+        reserved = 112 + 8 + get_varint_size(roll_count) + (int64_t) roll_count * 12;
+    } else if (flags & UNBOX_FLAG_DEFERRED_RESULTS) {
+        int64_t bitmap_bytes = (roll_count + 7) / 8;
+        reserved = 32 + get_varint_size(bitmap_bytes) + bitmap_bytes;
+    } else {
+        //Unboxassets scope and one unboxassets row (112 + 12 bytes) per roll
+        reserved = 112 + (int64_t) roll_count * 124;
+    }
+
+    //Unboxpacks row (112 + 24 bytes), and its unboxer index entry
+    reserved += 136 + (flags & UNBOX_FLAG_LEAN_UNBOXPACKS ? 0 : 128);
+
+    if (!(flags & UNBOX_FLAG_DEFERRED_RESULTS) && roll_count > MAX_UNBOX_DRAWS_PER_STEP) {
+        reserved += 112 + 56;
+    }
+    return reserved;
+}
+
+static int64_t get_expected_request_bytes(uint32_t num_packs) {
+    //signvals (112 + 8) and jobs (112 + 32) rows, and the unboxbatches row for multiple packs
+    int64_t request = 120 + 144;
+    if (num_packs > 1) {
+        request += 112 + 8 + get_varint_size(num_packs) + num_packs * 8;
+    }
+    return request;
+}
+
+static int64_t get_accounted_bytes() {
+    return get_collection_ram_balance() + get_collection_paid_bytes();
+}
+
+static bool has_unbox_rows(uint64_t pack_asset_id) {
+    for (name table : {name("unboxpacks"), name("leanunboxes"), name("unboxcursors"), name("unboxresults")}) {
+        if (chain().find_row({CONTRACT_ACCOUNT.value, CONTRACT_ACCOUNT.value, table.value}, pack_asset_id)) {
+            return true;
+        }
+    }
+    return !get_rows(CONTRACT_ACCOUNT, pack_asset_id, name("unboxassets")).empty();
+}
+
+static bool has_unboxcursor(uint64_t pack_asset_id) {
+    return chain().find_row({CONTRACT_ACCOUNT.value, CONTRACT_ACCOUNT.value, name("unboxcursors").value},
+        pack_asset_id) != nullptr;
+}
+
+static int count_rambalance_writes(const ACTION_RESULT &result) {
+    int writes = 0;
+    for (const DB_OPERATION &operation : result.db_operations) {
+        writes += operation.table_id.table == name("rambalances").value;
+    }
+    return writes;
+}
+
+static int count_reads(const ACTION_RESULT &result, name table) {
+    int reads = 0;
+    for (const auto &[table_id, primary_key] : result.db_reads) {
+        reads += table_id.table == table.value;
+    }
+    return reads;
+}
+
+static vector <int32_t> get_template_ids(const vector <atomicpacks::UNBOX_RESULT> &results) {
+    vector <int32_t> template_ids = {};
+    for (const atomicpacks::UNBOX_RESULT &result : results) {
+        template_ids.push_back(result.template_id);
+    }
+    return template_ids;
+}
+
+static vector <int32_t> get_logged_template_ids(const ACTION_RESULT &result, uint64_t pack_asset_id) {
+    for (const SENT_ACTION &sent_action : get_sent_actions(result, CONTRACT_ACCOUNT, name("logresult"))) {
+        auto data = unpack <std::tuple <uint64_t, uint64_t, vector <int32_t>>> (sent_action.data);
+        if (std::get <0> (data) == pack_asset_id) {
+            return std::get <2> (data);
+        }
+    }
+    return {};
+}
+
+static map <int32_t, int> count_minted_templates(const ACTION_RESULT &result) {
+    map <int32_t, int> minted = {};
+    for (const SENT_ACTION &sent_action : get_sent_actions(result, atomicassets::ATOMICASSETS_ACCOUNT,
+        name("mintasset"))) {
+        minted[std::get <3> (unpack <std::tuple <name, name, name, int32_t>> (sent_action.data))]++;
+    }
+    return minted;
+}
+
+
+/**
+* Opens packs, delivers the randomness, resumes stepped packs and claims all results with the claim method,
+* checking the RAM accounting after every action
+*/
+static void run_lifecycle(
+    uint32_t flags,
+    const vector <uint32_t> &roll_counts,
+    uint32_t num_packs,
+    CLAIM_METHOD claim_method
+) {
+    setup_chain(COLLECTION_RAM_BYTES);
+    TEST_PACK pack = create_pack(make_rolls(roll_counts), flags);
+
+    uint64_t roll_count = 0;
+    for (uint32_t count : roll_counts) {
+        roll_count += count;
+    }
+    int64_t initial_accounted = get_accounted_bytes();
+    map <int32_t, int> minted = {};
+    map <int32_t, int> expected_minted = {};
+    bool failed = false;
+
+    auto check_action = [&](const ACTION_RESULT &result, const char *action_name) {
+        if (!result.succeeded()) {
+            fprintf(stderr, "flags %u, %s: %s failed: %s\n", flags, CLAIM_METHOD_NAMES[claim_method], action_name,
+                result.error.c_str());
+            failed = true;
+        }
+        for (const auto &[template_id, count] : count_minted_templates(result)) {
+            minted[template_id] += count;
+        }
+        //Every action leaves the balance covering at least the bytes that are used
+        EXPECT(get_accounted_bytes() <= initial_accounted);
+        //Each action writes the balance at most once
+        EXPECT(count_rambalance_writes(result) <= 1);
+    };
+
+    //Claims free exactly the rows they claim and pay for exactly the assets they mint
+    auto check_claim = [&](const ACTION_RESULT &result, const char *action_name) {
+        int64_t accounted_before = get_accounted_bytes();
+        check_action(result, action_name);
+        EXPECT(get_accounted_bytes() == accounted_before);
+    };
+
+
+    int64_t balance_before_open = get_collection_ram_balance();
+    OPENED_PACKS opened = open_packs(pack, num_packs, UNBOXER);
+    check_action(opened.result, "open");
+    if (failed) {
+        return;
+    }
+    EXPECT(balance_before_open - get_collection_ram_balance()
+        == num_packs * get_expected_reserved_bytes(flags, roll_count) + get_expected_request_bytes(num_packs));
+
+    checksum256 random_value = make_random_value(flags * 1000 + roll_count + num_packs);
+    ACTION_RESULT receiverand_result = deliver_randomness(opened.pack_asset_ids[0], random_value);
+    check_action(receiverand_result, "receiverand");
+    EXPECT(count_rambalance_writes(receiverand_result) == 1);
+
+    map <uint64_t, vector <atomicpacks::UNBOX_RESULT>> expected_results = {};
+    map <uint64_t, vector <int32_t>> logged_template_ids = {};
+    for (uint64_t pack_asset_id : opened.pack_asset_ids) {
+        checksum256 seed = num_packs == 1 ? random_value : get_batch_seed(random_value, pack_asset_id);
+        expected_results[pack_asset_id] = preview_results(pack.pack_id, seed);
+        EXPECT(expected_results[pack_asset_id].size() == roll_count);
+        for (const atomicpacks::UNBOX_RESULT &result : expected_results[pack_asset_id]) {
+            if (result.template_id != -1) {
+                expected_minted[result.template_id]++;
+            }
+        }
+        logged_template_ids[pack_asset_id] = get_logged_template_ids(receiverand_result, pack_asset_id);
+    }
+
+    if (flags & UNBOX_FLAG_DIRECT_MINT) {
+        //Everything is minted at once, so the reserved bytes that the assets and their scope don't use are refunded
+        EXPECT(get_accounted_bytes() == initial_accounted);
+        EXPECT(minted == expected_minted);
+    }
+
+    //Packs with too many rolls are unboxed in multiple steps
+    for (uint64_t pack_asset_id : opened.pack_asset_ids) {
+        for (int step = 0; has_unboxcursor(pack_asset_id) && step < 10; step++) {
+            ACTION_RESULT resume_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+                contract.resumeunbox(pack_asset_id);
+            });
+            check_action(resume_result, "resumeunbox");
+            vector <int32_t> step_logged = get_logged_template_ids(resume_result, pack_asset_id);
+            if (!step_logged.empty()) {
+                logged_template_ids[pack_asset_id] = step_logged;
+            }
+        }
+        EXPECT(!has_unboxcursor(pack_asset_id));
+    }
+
+    switch (claim_method) {
+        case CLAIM_UNBOXED:
+            for (uint64_t pack_asset_id : opened.pack_asset_ids) {
+                if (!has_unbox_rows(pack_asset_id)) {
+                    continue;
+                }
+                const vector <atomicpacks::UNBOX_RESULT> &results = expected_results[pack_asset_id];
+                for (size_t first = 0; first < results.size(); first += 3) {
+                    vector <uint64_t> roll_ids = {};
+                    for (size_t i = first; i < std::min(first + 3, results.size()); i++) {
+                        roll_ids.push_back(results[i].origin_roll_id);
+                    }
+                    ACTION_RESULT claim_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+                        contract.claimunboxed(pack_asset_id, roll_ids);
+                    });
+                    check_claim(claim_result, "claimunboxed");
+                    vector <int32_t> claim_logged = get_logged_template_ids(claim_result, pack_asset_id);
+                    if (!claim_logged.empty()) {
+                        logged_template_ids[pack_asset_id] = claim_logged;
+                    }
+                }
+            }
+            break;
+
+        case CLAIM_ALL:
+            for (int call = 0; call < 1000; call++) {
+                ACTION_RESULT claim_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+                    contract.claimall(UNBOXER, 7);
+                });
+                if (claim_result.error.find("does not have any results") != string::npos) {
+                    break;
+                }
+                check_claim(claim_result, "claimall");
+                for (uint64_t pack_asset_id : opened.pack_asset_ids) {
+                    vector <int32_t> claim_logged = get_logged_template_ids(claim_result, pack_asset_id);
+                    if (!claim_logged.empty()) {
+                        logged_template_ids[pack_asset_id] = claim_logged;
+                    }
+                }
+            }
+            break;
+
+        case CLAIM_PENDING: {
+            uint64_t start_pack_asset_id = 0;
+            for (int call = 0; call < 1000; call++) {
+                uint64_t next_pack_asset_id = 0;
+                ACTION_RESULT claim_result = run_action({CONTRACT_ACCOUNT}, [&](atomicpacks &contract) {
+                    next_pack_asset_id = contract.claimpending(start_pack_asset_id, 7);
+                });
+                check_claim(claim_result, "claimpending");
+                for (uint64_t pack_asset_id : opened.pack_asset_ids) {
+                    vector <int32_t> claim_logged = get_logged_template_ids(claim_result, pack_asset_id);
+                    if (!claim_logged.empty()) {
+                        logged_template_ids[pack_asset_id] = claim_logged;
+                    }
+                }
+                if (next_pack_asset_id == 0 || failed) {
+                    break;
+                }
+                start_pack_asset_id = next_pack_asset_id;
+            }
+            break;
+        }
+    }
+
+    //The results match those drawn at once from the same seed, and all rows have been claimed
+    for (uint64_t pack_asset_id : opened.pack_asset_ids) {
+        EXPECT(logged_template_ids[pack_asset_id] == get_template_ids(expected_results[pack_asset_id]));
+        EXPECT(!has_unbox_rows(pack_asset_id));
+        EXPECT(atomicassets::get_assets(CONTRACT_ACCOUNT).find(pack_asset_id)
+            == atomicassets::get_assets(CONTRACT_ACCOUNT).end());
+    }
+    EXPECT(get_rows(CONTRACT_ACCOUNT, CONTRACT_ACCOUNT.value, name("unboxbatches")).empty());
+    EXPECT(minted == expected_minted);
+
+    //Everything that was reserved has been either refunded or used
+    EXPECT(get_accounted_bytes() == initial_accounted);
+    if (get_accounted_bytes() != initial_accounted) {
+        fprintf(stderr, "flags %u, %u packs of %lu rolls, %s: %ld bytes reserved but neither refunded nor used\n",
+            flags, num_packs, (unsigned long) roll_count, CLAIM_METHOD_NAMES[claim_method],
+            (long) (initial_accounted - get_accounted_bytes()));
+    }
+}
+
+
+static void test_ram_accounting_for_all_flags() {
+    const vector <uint32_t> flag_combinations = {
+        0,
+        UNBOX_FLAG_LEAN_UNBOXPACKS,
+        UNBOX_FLAG_DIRECT_MINT,
+        UNBOX_FLAG_DIRECT_MINT | UNBOX_FLAG_LEAN_UNBOXPACKS,
+        UNBOX_FLAG_PACKED_RESULTS,
+        UNBOX_FLAG_PACKED_RESULTS | UNBOX_FLAG_LEAN_UNBOXPACKS,
+        UNBOX_FLAG_DEFERRED_RESULTS,
+        UNBOX_FLAG_DEFERRED_RESULTS | UNBOX_FLAG_LEAN_UNBOXPACKS
+    };
+
+    for (uint32_t flags : flag_combinations) {
+        for (CLAIM_METHOD claim_method : {CLAIM_UNBOXED, CLAIM_ALL, CLAIM_PENDING}) {
+            //Lean packs are not part of the unboxer index that claimall uses
+            if (claim_method == CLAIM_ALL && (flags & UNBOX_FLAG_LEAN_UNBOXPACKS)) {
+                continue;
+            }
+
+            run_lifecycle(flags, {1, 2, 1}, 1, claim_method);
+            run_lifecycle(flags, {1, 2, 1}, 3, claim_method);
+
+            //Packs with direct minting or deferred results are limited in their number of rolls
+            if (!(flags & (UNBOX_FLAG_DIRECT_MINT | UNBOX_FLAG_DEFERRED_RESULTS))) {
+                run_lifecycle(flags, {150, 1, 299}, 1, claim_method);
+                run_lifecycle(flags, {400}, 1, claim_method);
+            }
+        }
+    }
+}
+
+
+static void test_ram_ledger_is_settled_once_per_action() {
+    setup_chain(COLLECTION_RAM_BYTES);
+    TEST_PACK pack = create_pack(make_rolls({2, 3}), 0);
+
+    vector <uint64_t> pack_asset_ids = {};
+    for (int i = 0; i < 3; i++) {
+        OPENED_PACKS opened = open_packs(pack, 1, UNBOXER);
+        EXPECT(opened.result.succeeded());
+        //Reserving the bytes for the pack and for the randomness request is written once
+        EXPECT(count_rambalance_writes(opened.result) == 1);
+        EXPECT(deliver_randomness(opened.pack_asset_ids[0], make_random_value(i)).succeeded());
+        pack_asset_ids.push_back(opened.pack_asset_ids[0]);
+    }
+
+    //Claiming the results of multiple packs changes the balance many times, but only writes it once
+    ACTION_RESULT claim_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.claimall(UNBOXER, 100);
+    });
+    EXPECT(claim_result.succeeded());
+    EXPECT(count_rambalance_writes(claim_result) == 1);
+    for (uint64_t pack_asset_id : pack_asset_ids) {
+        EXPECT(!has_unbox_rows(pack_asset_id));
+    }
+
+    //A failing action doesn't change the balance, even though the ledger is settled when the contract is destructed
+    int64_t balance = get_collection_ram_balance();
+    ACTION_RESULT withdraw_result = run_action({AUTHOR}, [&](atomicpacks &contract) {
+        contract.withdrawram(AUTHOR, COLLECTION_NAME, AUTHOR, balance + 1);
+    });
+    EXPECT(withdraw_result.error == "The collection does not have a sufficient ram balance");
+    EXPECT(get_collection_ram_balance() == balance);
+
+    //The ledger also fails the action if the net decrease is more than the balance
+    setup_chain(1000);
+    pack = create_pack(make_rolls({20}), 0);
+    OPENED_PACKS opened = open_packs(pack, 1, UNBOXER);
+    EXPECT(opened.result.error == "The collection does not have enough RAM to pay for the reserved bytes");
+    EXPECT(get_collection_ram_balance() == 1000 - 128);
+    EXPECT(!has_unbox_rows(opened.pack_asset_ids[0]));
+}
+
+
+static void test_batch_seeds_and_ram() {
+    setup_chain(COLLECTION_RAM_BYTES);
+    TEST_PACK pack = create_pack(make_rolls({2, 3}), 0);
+
+    OPENED_PACKS opened = open_packs(pack, 3, UNBOXER);
+    EXPECT(opened.result.succeeded());
+
+    //The unboxbatches row holds the pack asset ids, and is paid from the balance like the randomness request
+    int64_t batch_row_bytes = 0;
+    for (const DB_OPERATION &operation : opened.result.db_operations) {
+        if (operation.table_id.table == name("unboxbatches").value) {
+            EXPECT(operation.type == DB_OPERATION::EMPLACE);
+            batch_row_bytes += operation.ram_delta;
+        }
+    }
+    EXPECT(batch_row_bytes == 112 + 8 + 1 + 3 * 8);
+    EXPECT(get_sent_actions(opened.result, orng::ORNG_CONTRACT, name("requestrand")).size() == 1);
+
+    int64_t balance_before = get_collection_ram_balance();
+    checksum256 random_value = make_random_value(7);
+    ACTION_RESULT receiverand_result = deliver_randomness(opened.pack_asset_ids[0], random_value);
+    EXPECT(receiverand_result.succeeded());
+    //The jobs row and the unboxbatches row are refunded
+    EXPECT(get_collection_ram_balance() - balance_before == 144 + batch_row_bytes);
+    EXPECT(get_rows(CONTRACT_ACCOUNT, CONTRACT_ACCOUNT.value, name("unboxbatches")).empty());
+
+    //Each pack is unboxed with its own seed derived from the random value
+    for (uint64_t pack_asset_id : opened.pack_asset_ids) {
+        vector <int32_t> expected = get_template_ids(
+            preview_results(pack.pack_id, get_batch_seed(random_value, pack_asset_id)));
+        EXPECT(get_logged_template_ids(receiverand_result, pack_asset_id) == expected);
+        EXPECT(get_rows(CONTRACT_ACCOUNT, pack_asset_id, name("unboxassets")).size() == 5);
+    }
+
+    //Packs opened together are unboxed in a single action, so their rolls are limited
+    TEST_PACK large_pack = create_pack(make_rolls({150}), 0);
+    OPENED_PACKS large_opened = open_packs(large_pack, 2, UNBOXER);
+    EXPECT(large_opened.result.error == "Packs opened at the same time can't have more than 200 rolls in total");
+    EXPECT(!has_unbox_rows(large_opened.pack_asset_ids[0]));
+}
+
+
+static void test_stepped_unboxing() {
+    setup_chain(COLLECTION_RAM_BYTES);
+    TEST_PACK pack = create_pack(make_rolls({150, 1, 299}), UNBOX_FLAG_PACKED_RESULTS);
+
+    OPENED_PACKS opened = open_packs(pack, 1, UNBOXER);
+    EXPECT(opened.result.succeeded());
+    uint64_t pack_asset_id = opened.pack_asset_ids[0];
+
+    checksum256 random_value = make_random_value(3);
+    ACTION_RESULT receiverand_result = deliver_randomness(pack_asset_id, random_value);
+    EXPECT(receiverand_result.succeeded());
+    //Each step only reads the bundle chunk it draws from
+    EXPECT(count_reads(receiverand_result, name("bundlechunks")) == 1);
+    EXPECT(get_logged_template_ids(receiverand_result, pack_asset_id).empty());
+
+    vector <UNBOXCURSOR_ROW> cursors = read_rows <UNBOXCURSOR_ROW> (
+        CONTRACT_ACCOUNT, CONTRACT_ACCOUNT.value, name("unboxcursors"));
+    EXPECT(cursors.size() == 1 && cursors[0].next_roll_id == 200 && cursors[0].seed == random_value);
+
+    //The results can only be claimed once all rolls have been drawn
+    ACTION_RESULT early_claim_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.claimunboxed(pack_asset_id, {0});
+    });
+    EXPECT(early_claim_result.error == "The pack is unboxed in multiple steps and not all rolls have been drawn yet");
+    ACTION_RESULT early_claimall_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.claimall(UNBOXER, 10);
+    });
+    EXPECT(early_claimall_result.error == "The unboxer does not have any results that can be claimed");
+
+    ACTION_RESULT stranger_result = run_action({STRANGER}, [&](atomicpacks &contract) {
+        contract.resumeunbox(pack_asset_id);
+    });
+    EXPECT(!stranger_result.succeeded());
+
+    ACTION_RESULT second_step_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.resumeunbox(pack_asset_id);
+    });
+    EXPECT(second_step_result.succeeded());
+    EXPECT(count_reads(second_step_result, name("bundlechunks")) == 1);
+    cursors = read_rows <UNBOXCURSOR_ROW> (CONTRACT_ACCOUNT, CONTRACT_ACCOUNT.value, name("unboxcursors"));
+    EXPECT(cursors.size() == 1 && cursors[0].next_roll_id == 400);
+
+    int64_t balance_before = get_collection_ram_balance();
+    ACTION_RESULT last_step_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.resumeunbox(pack_asset_id);
+    });
+    EXPECT(last_step_result.succeeded());
+    EXPECT(count_reads(last_step_result, name("bundlechunks")) == 1);
+    EXPECT(!has_unboxcursor(pack_asset_id));
+    //Only the cursor is refunded, the unboxresults row uses the bytes reserved for it
+    EXPECT(get_collection_ram_balance() - balance_before == 168);
+
+    //Drawing in steps gives the same results as drawing all rolls at once
+    EXPECT(get_logged_template_ids(last_step_result, pack_asset_id)
+        == get_template_ids(preview_results(pack.pack_id, random_value)));
+
+    ACTION_RESULT done_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.resumeunbox(pack_asset_id);
+    });
+    EXPECT(done_result.error == "The pack is not being unboxed in multiple steps");
+
+    //A pack with exactly two steps of draws is done after the first resume
+    TEST_PACK two_step_pack = create_pack(make_rolls({400}), 0);
+    OPENED_PACKS two_step_opened = open_packs(two_step_pack, 1, UNBOXER);
+    EXPECT(deliver_randomness(two_step_opened.pack_asset_ids[0], random_value).succeeded());
+    EXPECT(has_unboxcursor(two_step_opened.pack_asset_ids[0]));
+    EXPECT(run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.resumeunbox(two_step_opened.pack_asset_ids[0]);
+    }).succeeded());
+    EXPECT(!has_unboxcursor(two_step_opened.pack_asset_ids[0]));
+    EXPECT(get_rows(CONTRACT_ACCOUNT, two_step_opened.pack_asset_ids[0], name("unboxassets")).size() == 400);
+}
+
+
+static void test_deferred_results_bitmap() {
+    setup_chain(COLLECTION_RAM_BYTES);
+    TEST_PACK pack = create_pack(make_rolls({6, 7}), UNBOX_FLAG_DEFERRED_RESULTS);
+
+    OPENED_PACKS opened = open_packs(pack, 1, UNBOXER);
+    EXPECT(opened.result.succeeded());
+    uint64_t pack_asset_id = opened.pack_asset_ids[0];
+
+    checksum256 random_value = make_random_value(11);
+    ACTION_RESULT receiverand_result = deliver_randomness(pack_asset_id, random_value);
+    EXPECT(receiverand_result.succeeded());
+    //Only the seed and a bitmap with one bit per roll are added to the unboxpacks row
+    for (const DB_OPERATION &operation : receiverand_result.db_operations) {
+        if (operation.table_id.table == name("unboxpacks").value) {
+            EXPECT(operation.type == DB_OPERATION::MODIFY && operation.ram_delta == 32 + 1 + 2);
+        }
+    }
+    EXPECT(get_logged_template_ids(receiverand_result, pack_asset_id).empty());
+
+    auto read_bitmap = [&]() {
+        vector <UNBOXPACK_ROW> unboxpacks = read_rows <UNBOXPACK_ROW> (
+            CONTRACT_ACCOUNT, CONTRACT_ACCOUNT.value, name("unboxpacks"));
+        return unboxpacks.size() == 1 && unboxpacks[0].unbox_seed.has_value()
+            ? unboxpacks[0].unbox_seed.value().claimed_rolls
+            : vector <uint8_t> {};
+    };
+    EXPECT(read_bitmap() == vector <uint8_t> ({0, 0}));
+
+    //The results are logged when the first roll is claimed
+    ACTION_RESULT first_claim_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.claimunboxed(pack_asset_id, {0, 12});
+    });
+    EXPECT(first_claim_result.succeeded());
+    EXPECT(get_logged_template_ids(first_claim_result, pack_asset_id)
+        == get_template_ids(preview_results(pack.pack_id, random_value)));
+    EXPECT(read_bitmap() == vector <uint8_t> ({0x01, 0x10}));
+
+    //A claimed roll can't be claimed again
+    ACTION_RESULT double_claim_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.claimunboxed(pack_asset_id, {1, 0});
+    });
+    EXPECT(double_claim_result.error == "No unbox asset with the origin roll id 0 exists");
+    EXPECT(read_bitmap() == vector <uint8_t> ({0x01, 0x10}));
+
+    ACTION_RESULT stranger_result = run_action({STRANGER}, [&](atomicpacks &contract) {
+        contract.claimunboxed(pack_asset_id, {1});
+    });
+    EXPECT(!stranger_result.succeeded());
+
+    vector <uint64_t> remaining_roll_ids = {};
+    for (uint64_t roll_id = 1; roll_id < 12; roll_id++) {
+        remaining_roll_ids.push_back(roll_id);
+    }
+    int64_t balance_before = get_collection_ram_balance();
+    int64_t paid_before = get_collection_paid_bytes();
+    ACTION_RESULT last_claim_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.claimunboxed(pack_asset_id, remaining_roll_ids);
+    });
+    EXPECT(last_claim_result.succeeded());
+    EXPECT(get_logged_template_ids(last_claim_result, pack_asset_id).empty());
+    EXPECT(!has_unbox_rows(pack_asset_id));
+    EXPECT(get_collection_ram_balance() - balance_before == paid_before - get_collection_paid_bytes());
+}
+
+
+static void test_claimpending_resumes_at_returned_pack() {
+    setup_chain(COLLECTION_RAM_BYTES);
+    TEST_PACK normal_pack = create_pack(make_rolls({6}), 0);
+    TEST_PACK lean_pack = create_pack(make_rolls({5}), UNBOX_FLAG_LEAN_UNBOXPACKS);
+    TEST_PACK other_lean_pack = create_pack(make_rolls({4}), UNBOX_FLAG_LEAN_UNBOXPACKS | UNBOX_FLAG_PACKED_RESULTS);
+
+    //The packs of both tables are walked in the order of their asset ids
+    uint64_t first = open_packs(normal_pack, 1, UNBOXER).pack_asset_ids[0];
+    uint64_t second = open_packs(lean_pack, 1, UNBOXER).pack_asset_ids[0];
+    uint64_t waiting = open_packs(normal_pack, 1, UNBOXER).pack_asset_ids[0];
+    uint64_t fourth = open_packs(other_lean_pack, 1, UNBOXER).pack_asset_ids[0];
+    for (uint64_t pack_asset_id : {first, second, fourth}) {
+        EXPECT(deliver_randomness(pack_asset_id, make_random_value(pack_asset_id)).succeeded());
+    }
+    int64_t initial_accounted = get_accounted_bytes();
+
+    auto claim_pending = [&](uint64_t start_pack_asset_id) {
+        uint64_t next_pack_asset_id = 0;
+        EXPECT(run_action({CONTRACT_ACCOUNT}, [&](atomicpacks &contract) {
+            next_pack_asset_id = contract.claimpending(start_pack_asset_id, 4);
+        }).succeeded());
+        return next_pack_asset_id;
+    };
+
+    //The budget runs out within the first pack, which is returned to continue with it
+    EXPECT(claim_pending(0) == first);
+    EXPECT(get_rows(CONTRACT_ACCOUNT, first, name("unboxassets")).size() == 2);
+    //The first pack is finished and the budget runs out within the second pack
+    EXPECT(claim_pending(first) == second);
+    EXPECT(!has_unbox_rows(first));
+    //The second pack is finished, and the pack without randomness uses up the rest of the budget
+    EXPECT(claim_pending(second) == fourth);
+    EXPECT(!has_unbox_rows(second));
+    EXPECT(has_unbox_rows(waiting));
+    //The last pack is finished, which is the end of both tables
+    EXPECT(claim_pending(fourth) == 0);
+    EXPECT(!has_unbox_rows(fourth));
+    EXPECT(get_accounted_bytes() == initial_accounted);
+
+    EXPECT(deliver_randomness(waiting, make_random_value(waiting)).succeeded());
+    EXPECT(claim_pending(0) == waiting);
+    EXPECT(claim_pending(waiting) == 0);
+    EXPECT(!has_unbox_rows(waiting));
+
+    //Requires the authorization of the contract
+    EXPECT(!run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.claimpending(0, 4);
+    }).succeeded());
+}
+
+
+static void test_claimall_counts_skipped_packs() {
+    setup_chain(COLLECTION_RAM_BYTES);
+    TEST_PACK pack = create_pack(make_rolls({3}), 0);
+
+    uint64_t waiting = open_packs(pack, 1, UNBOXER).pack_asset_ids[0];
+    uint64_t received = open_packs(pack, 1, UNBOXER).pack_asset_ids[0];
+    EXPECT(deliver_randomness(received, make_random_value(1)).succeeded());
+
+    //The pack without randomness comes first and uses up the only claim
+    ACTION_RESULT skipped_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.claimall(UNBOXER, 1);
+    });
+    EXPECT(skipped_result.error == "The unboxer does not have any results that can be claimed");
+
+    ACTION_RESULT claim_result = run_action({UNBOXER}, [&](atomicpacks &contract) {
+        contract.claimall(UNBOXER, 2);
+    });
+    EXPECT(claim_result.succeeded());
+    EXPECT(get_rows(CONTRACT_ACCOUNT, received, name("unboxassets")).size() == 2);
+    EXPECT(has_unbox_rows(waiting));
+}
+
+
+int main() {
+    test_ram_accounting_for_all_flags();
+    test_ram_ledger_is_settled_once_per_action();
+    test_batch_seeds_and_ram();
+    test_stepped_unboxing();
+    test_deferred_results_bitmap();
+    test_claimpending_resumes_at_returned_pack();
+    test_claimall_counts_skipped_packs();
+
+    return finish_test("atomicpacks_test");
+}
@@ -0,0 +1,136 @@
+/*
+
+Differential test of the integer bancor math in ram-interface.hpp against the floating point formula
+of the system contract, which it has to reproduce exactly for non negative inputs
+
+*/
+
+#include <random>
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+
+#include <ram-interface.hpp>
+
+#include "testing.hpp"
+
+using namespace std;
+
+
+//From exchange_state.cpp in eosio.system contract source, as it was used before the integer implementation
+static int64_t get_bancor_output_double(
+    int64_t inp_reserve,
+    int64_t out_reserve,
+    int64_t inp
+) {
+    const double ib = inp_reserve;
+    const double ob = out_reserve;
+    const double in = inp;
+
+    int64_t out = int64_t( (in * ob) / (ib + in) );
+
+    if ( out < 0 ) out = 0;
+
+    return out;
+}
+
+
+//Inputs for which the double formula is defined, i.e. the result can be converted to int64_t
+static bool is_comparable(int64_t inp_reserve, int64_t out_reserve, int64_t inp) {
+    double quotient = ((double) inp * (double) out_reserve) / ((double) inp_reserve + (double) inp);
+    return quotient < 9223372036854775808.0;
+}
+
+
+static int compare(int64_t inp_reserve, int64_t out_reserve, int64_t inp) {
+    if (!is_comparable(inp_reserve, out_reserve, inp)) {
+        return 0;
+    }
+
+    int64_t expected = get_bancor_output_double(inp_reserve, out_reserve, inp);
+    int64_t actual = ram::get_bancor_output(inp_reserve, out_reserve, inp);
+    if (actual != expected) {
+        failed_expectations++;
+        if (failed_expectations <= 10) {
+            fprintf(stderr, "get_bancor_output(%lld, %lld, %lld) = %lld, expected %lld\n",
+                (long long) inp_reserve, (long long) out_reserve, (long long) inp,
+                (long long) actual, (long long) expected);
+        }
+    }
+    return 1;
+}
+
+
+static void test_edge_cases() {
+    const int64_t values[] = {
+        0, 1, 2, 3, 199, 200, 1000, (1ll << 24) - 1, 1ll << 24, (1ll << 53) - 1, 1ll << 53, (1ll << 53) + 1,
+        (1ll << 53) + 3, (1ll << 62) - 1, 1ll << 62, INT64_MAX - 1, INT64_MAX
+    };
+    for (int64_t inp_reserve : values) {
+        for (int64_t out_reserve : values) {
+            for (int64_t inp : values) {
+                compare(inp_reserve, out_reserve, inp);
+            }
+        }
+    }
+}
+
+
+//Reserves and inputs of every magnitude, with random low bits so that all rounding cases are hit
+static void test_random_magnitudes() {
+    mt19937_64 generator(1);
+    auto random_value = [&]() -> int64_t {
+        int bits = generator() % 64;
+        return bits == 0 ? 0 : (int64_t) (generator() >> (64 - bits)) & INT64_MAX;
+    };
+
+    int compared = 0;
+    for (int i = 0; i < 3000000; i++) {
+        compared += compare(random_value(), random_value(), random_value());
+    }
+    EXPECT(compared > 2000000);
+}
+
+
+//Values close to the ones of the WAX RAM market, where the results are actually used
+static void test_market_values() {
+    mt19937_64 generator(2);
+    for (int i = 0; i < 2000000; i++) {
+        int64_t ram_reserve = 100000000000ll + generator() % 400000000000ll;
+        int64_t core_reserve = 1000000000000000ll + generator() % 40000000000000000ll;
+        int64_t core_amount = generator() % 100000000000000ll;
+        int64_t ram_bytes = generator() % 10000000000ll;
+
+        compare(core_reserve, ram_reserve, core_amount);
+        compare(ram_reserve, core_reserve, ram_bytes);
+    }
+}
+
+
+static void test_market_quotes() {
+    ram::rammarket.emplace(name("eosio"), [&](auto &_market) {
+        _market.supply = asset(10000000000000ll, ram::RAMCORE_SYMBOL);
+        _market.base.balance = asset(200000000000ll, symbol("RAM", 0));
+        _market.quote.balance = asset(3000000000000000ll, symbol("WAX", 8));
+    });
+
+    //The fee of 0.5% is rounded up and taken from the purchase amount, or from the sale proceeds
+    asset purchase_quantity = asset(100000000, symbol("WAX", 8));
+    EXPECT(ram::get_purchase_ram_bytes(purchase_quantity)
+        == get_bancor_output_double(3000000000000000ll, 200000000000ll, 100000000 - 500000));
+
+    int64_t full_amount = get_bancor_output_double(200000000000ll, 3000000000000000ll, 1000000);
+    asset sell_quantity = ram::get_sell_ram_quantity(1000000);
+    EXPECT(sell_quantity.amount == full_amount - (full_amount + 199) / 200);
+    EXPECT(sell_quantity.symbol == symbol("WAX", 8));
+}
+
+
+int main() {
+    test_edge_cases();
+    test_random_magnitudes();
+    test_market_values();
+    test_market_quotes();
+
+    return finish_test("bancor_diff");
+}
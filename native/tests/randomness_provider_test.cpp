@@ -0,0 +1,149 @@
+#include <array>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <eosio/crypto.hpp>
+
+#include "testing.hpp"
+
+using namespace std;
+using namespace eosio;
+
+#include "../../src/randomness_provider.cpp"
+
+
+static checksum256 make_seed(mt19937_64 &generator) {
+    array <uint8_t, 32> bytes;
+    for (uint8_t &byte : bytes) {
+        byte = (uint8_t) generator();
+    }
+    return checksum256(bytes);
+}
+
+
+//The mock sha256 needs to match the chain, otherwise none of the other results are meaningful
+static void test_sha256() {
+    const char *abc = "abc";
+    array <uint8_t, 32> expected = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+    };
+    EXPECT(eosio::sha256(abc, 3).extract_as_byte_array() == expected);
+
+    //Two blocks of padding are needed for this length
+    string long_input = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    array <uint8_t, 32> expected_long = {
+        0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+        0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1
+    };
+    EXPECT(eosio::sha256(long_input.data(), long_input.size()).extract_as_byte_array() == expected_long);
+}
+
+
+//Block i of the stream is sha256(seed || i), consumed 8 bytes at a time
+static void test_counter_mode_blocks() {
+    mt19937_64 generator(1);
+    checksum256 seed = make_seed(generator);
+    RandomnessProvider randomness_provider(seed);
+
+    for (uint64_t counter = 0; counter < 3; counter++) {
+        array <uint8_t, 40> block_input;
+        memcpy(block_input.data(), seed.extract_as_byte_array().data(), 32);
+        memcpy(block_input.data() + 32, &counter, sizeof(counter));
+        array <uint8_t, 32> block = eosio::sha256((char *) block_input.data(), block_input.size())
+            .extract_as_byte_array();
+
+        for (int offset = 0; offset < 32; offset += 8) {
+            uint64_t expected;
+            memcpy(&expected, block.data() + offset, sizeof(expected));
+            EXPECT(randomness_provider.get_uint64() == expected);
+        }
+    }
+}
+
+
+//Resuming at a stored position continues with exactly the same values
+static void test_resume_at_position() {
+    mt19937_64 generator(2);
+    checksum256 seed = make_seed(generator);
+
+    RandomnessProvider full_stream(seed);
+    vector <uint64_t> values(40);
+    for (uint64_t &value : values) {
+        value = full_stream.get_uint64();
+    }
+    EXPECT(full_stream.get_position() == values.size());
+
+    for (uint64_t position = 0; position < values.size(); position++) {
+        RandomnessProvider resumed_stream(seed, position);
+        EXPECT(resumed_stream.get_position() == position);
+        for (uint64_t i = position; i < values.size(); i++) {
+            EXPECT(resumed_stream.get_uint64() == values[i]);
+        }
+    }
+}
+
+
+//Drawing in steps gives the same values as drawing at once, which stepped unboxing relies on
+static void test_stepped_draws() {
+    mt19937_64 generator(3);
+    checksum256 seed = make_seed(generator);
+
+    vector <uint64_t> bounds(500);
+    for (uint64_t &bound : bounds) {
+        bound = generator() % 1000 + 1;
+    }
+
+    vector <uint64_t> values_at_once;
+    RandomnessProvider(seed).fill(values_at_once, bounds);
+
+    vector <uint64_t> values_in_steps;
+    uint64_t position = 0;
+    for (size_t start = 0; start < bounds.size(); start += 37) {
+        vector <uint64_t> step_bounds(bounds.begin() + start, bounds.begin() + min(start + 37, bounds.size()));
+        vector <uint64_t> step_values;
+
+        RandomnessProvider randomness_provider(seed, position);
+        randomness_provider.fill(step_values, step_bounds);
+        position = randomness_provider.get_position();
+
+        values_in_steps.insert(values_in_steps.end(), step_values.begin(), step_values.end());
+    }
+
+    EXPECT(values_in_steps == values_at_once);
+}
+
+
+static void test_bounded_values() {
+    mt19937_64 generator(4);
+    RandomnessProvider randomness_provider(make_seed(generator));
+
+    for (uint64_t max_value : {1ull, 2ull, 3ull, 7ull, 64ull, 1000ull, (1ull << 63) + 1, ~0ull}) {
+        for (int i = 0; i < 1000; i++) {
+            EXPECT(randomness_provider.get_rand_uint64(max_value) < max_value);
+        }
+    }
+
+    //Every value of a small range is drawn about equally often
+    const uint32_t max_value = 6;
+    const int draws = 600000;
+    vector <int> counts(max_value);
+    for (int i = 0; i < draws; i++) {
+        counts[randomness_provider.get_rand(max_value)]++;
+    }
+    for (int count : counts) {
+        EXPECT(count > draws / max_value * 0.98 && count < draws / max_value * 1.02);
+    }
+}
+
+
+int main() {
+    test_sha256();
+    test_counter_mode_blocks();
+    test_resume_at_position();
+    test_stepped_draws();
+    test_bounded_values();
+
+    return finish_test("randomness_provider_test");
+}
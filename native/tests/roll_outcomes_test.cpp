@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <map>
+#include <random>
+
+#include <roll-outcomes.hpp>
+
+#include "testing.hpp"
+
+
+static vector <OUTCOME> make_outcomes(mt19937_64 &generator, size_t num_outcomes, uint32_t max_odds) {
+    vector <OUTCOME> outcomes(num_outcomes);
+    int32_t template_id = generator() % 1000;
+    for (OUTCOME &outcome : outcomes) {
+        outcome.odds = generator() % max_odds + 1;
+        //Mostly increasing template ids, with some gaps, decreases and no NFT outcomes
+        template_id += (int32_t) (generator() % 20) - 4;
+        outcome.template_id = generator() % 10 == 0 ? -1 : template_id;
+    }
+    sort(outcomes.begin(), outcomes.end(), [](const OUTCOME &a, const OUTCOME &b) { return a.odds > b.odds; });
+    return outcomes;
+}
+
+
+static bool outcomes_equal(const vector <OUTCOME> &a, const vector <OUTCOME> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].odds != b[i].odds || a[i].template_id != b[i].template_id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static void test_varint_bytes() {
+    EXPECT(get_varint_bytes(0) == 1);
+    EXPECT(get_varint_bytes(127) == 1);
+    EXPECT(get_varint_bytes(128) == 2);
+    EXPECT(get_varint_bytes(16383) == 2);
+    EXPECT(get_varint_bytes(16384) == 3);
+    EXPECT(get_varint_bytes(~0ull) == 10);
+}
+
+
+static void test_encoding_round_trip() {
+    mt19937_64 generator(1);
+    int encoded_rolls = 0;
+
+    for (int i = 0; i < 20000; i++) {
+        uint32_t max_odds = i % 3 == 0 ? 100 : i % 3 == 1 ? 60000 : 100000000;
+        vector <OUTCOME> outcomes = make_outcomes(generator, generator() % 50 + 1, max_odds);
+
+        bool count_stored = i % 2 == 0;
+        vector <uint8_t> encoding = encode_outcomes(outcomes, count_stored);
+
+        int64_t plain_bytes = get_varint_bytes(outcomes.size()) + (int64_t) (outcomes.size() * sizeof(OUTCOME))
+            + (count_stored ? 4 : 0);
+        if (encoding.empty()) {
+            //Storing the count anyway can only make encoding more attractive
+            EXPECT(!count_stored || encode_outcomes(outcomes, false).empty());
+            continue;
+        }
+        encoded_rolls++;
+
+        EXPECT(encoding[0] == OUTCOME_ENCODING_SMALL_ODDS || encoding[0] == OUTCOME_ENCODING_DELTA);
+        EXPECT(encoding[0] != OUTCOME_ENCODING_SMALL_ODDS || max_odds <= 0xFFFF);
+        EXPECT(outcomes_equal(decode_outcomes(encoding), outcomes));
+
+        //An encoding is only used if the row gets smaller, including the count if the plain row stores it as well
+        EXPECT(get_varint_bytes(0) + 4 + get_varint_bytes(encoding.size()) + (int64_t) encoding.size() < plain_bytes);
+    }
+
+    EXPECT(encoded_rolls > 10000);
+}
+
+
+static void test_encoding_extremes() {
+    vector <OUTCOME> outcomes = {
+        {0xFFFFFFFF, INT32_MAX},
+        {0xFFFFFFFF, INT32_MIN},
+        {1, -1},
+        {1, INT32_MAX}
+    };
+    vector <uint8_t> encoding = encode_outcomes(outcomes, false);
+    if (!encoding.empty()) {
+        EXPECT(outcomes_equal(decode_outcomes(encoding), outcomes));
+    }
+
+    //The plain row takes 9 bytes, or 13 with the count, and the delta encoded row 12 bytes including the count
+    vector <OUTCOME> single_outcome = {{1, 100000}};
+    EXPECT(encode_outcomes(single_outcome, false).empty());
+    EXPECT(!encode_outcomes(single_outcome, true).empty());
+}
+
+
+//Summing up the column parts of each template has to give exactly its odds, scaled by the number of entries
+static void test_alias_table_is_exact() {
+    mt19937_64 generator(2);
+
+    for (int i = 0; i < 5000; i++) {
+        size_t num_outcomes = generator() % 64 + 1;
+        vector <OUTCOME> outcomes = make_outcomes(generator, num_outcomes, i % 2 == 0 ? 10 : 1000000);
+        //Unique template ids, so that every outcome can be identified in the table
+        uint32_t total_odds = 0;
+        for (size_t j = 0; j < outcomes.size(); j++) {
+            outcomes[j].template_id = (int32_t) j;
+            total_odds += outcomes[j].odds;
+        }
+
+        vector <ALIAS_ENTRY> entries = build_alias_table(outcomes, total_odds);
+        EXPECT(entries.size() == num_outcomes);
+
+        map <int32_t, uint64_t> scaled_odds = {};
+        for (const ALIAS_ENTRY &entry : entries) {
+            EXPECT(entry.threshold <= total_odds);
+            scaled_odds[entry.template_id] += entry.threshold;
+            scaled_odds[entry.alias_template_id] += total_odds - entry.threshold;
+        }
+        for (const OUTCOME &outcome : outcomes) {
+            EXPECT(scaled_odds[outcome.template_id] == (uint64_t) outcome.odds * num_outcomes);
+        }
+    }
+}
+
+
+//Going through every possible random value selects each outcome exactly odds * entries times
+static void test_alias_outcome_selection() {
+    mt19937_64 generator(3);
+
+    for (int i = 0; i < 500; i++) {
+        vector <OUTCOME> outcomes = make_outcomes(generator, generator() % 8 + 1, 50);
+        uint32_t total_odds = 0;
+        for (size_t j = 0; j < outcomes.size(); j++) {
+            outcomes[j].template_id = (int32_t) j;
+            total_odds += outcomes[j].odds;
+        }
+
+        vector <ALIAS_ENTRY> entries = build_alias_table(outcomes, total_odds);
+
+        map <int32_t, uint64_t> selections = {};
+        for (uint64_t rand = 0; rand < entries.size() * (uint64_t) total_odds; rand++) {
+            selections[get_alias_outcome(entries.data(), total_odds, rand)]++;
+        }
+        for (const OUTCOME &outcome : outcomes) {
+            EXPECT(selections[outcome.template_id] == (uint64_t) outcome.odds * entries.size());
+        }
+    }
+}
+
+
+static void test_alias_table_encoding() {
+    mt19937_64 generator(4);
+    size_t encoded_bytes = 0;
+    size_t plain_bytes = 0;
+
+    for (int i = 0; i < 5000; i++) {
+        //Duplicate template ids are possible, any entry with the alias template id can be referenced
+        vector <OUTCOME> outcomes = make_outcomes(generator, generator() % 100 + 1, i % 2 == 0 ? 100 : 1000000);
+        uint32_t total_odds = 0;
+        for (const OUTCOME &outcome : outcomes) {
+            total_odds += outcome.odds;
+        }
+
+        vector <ALIAS_ENTRY> entries = build_alias_table(outcomes, total_odds);
+        vector <uint8_t> encoding = encode_alias_table(entries, total_odds);
+        vector <ALIAS_ENTRY> decoded_entries = decode_alias_table(encoding, total_odds);
+
+        EXPECT(decoded_entries.size() == entries.size());
+        for (size_t j = 0; j < entries.size() && j < decoded_entries.size(); j++) {
+            EXPECT(decoded_entries[j].threshold == entries[j].threshold);
+            EXPECT(decoded_entries[j].template_id == entries[j].template_id);
+            EXPECT(decoded_entries[j].alias_template_id == entries[j].alias_template_id);
+        }
+
+        encoded_bytes += encoding.size();
+        plain_bytes += entries.size() * sizeof(ALIAS_ENTRY);
+    }
+
+    EXPECT(encoded_bytes * 2 < plain_bytes);
+}
+
+
+int main() {
+    test_varint_bytes();
+    test_encoding_round_trip();
+    test_encoding_extremes();
+    test_alias_table_is_exact();
+    test_alias_outcome_selection();
+    test_alias_table_encoding();
+
+    return finish_test("roll_outcomes_test");
+}
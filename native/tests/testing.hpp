@@ -0,0 +1,29 @@
+/*
+
+Minimal helpers shared by the native tests. Each test is a separate executable that
+returns a non zero exit code if any of its expectations failed.
+
+*/
+
+#pragma once
+
+#include <cstdio>
+
+static int failed_expectations = 0;
+
+#define EXPECT(condition) \
+    do { \
+        if (!(condition)) { \
+            failed_expectations++; \
+            fprintf(stderr, "%s:%d: expectation failed: %s\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (0)
+
+inline int finish_test(const char *test_name) {
+    if (failed_expectations != 0) {
+        fprintf(stderr, "%s: %d expectations failed\n", test_name, failed_expectations);
+        return 1;
+    }
+    printf("%s: passed\n", test_name);
+    return 0;
+}
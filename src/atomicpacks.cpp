@@ -3,6 +3,7 @@
 #include "ram_handling.cpp"
 #include "pack_creation.cpp"
 #include "unboxing.cpp"
+#include "queries.cpp"
 
 
 /**
@@ -24,6 +25,7 @@ ACTION atomicpacks::setident(
 * Requests new randomness for a given assoc_id
 * This is supposed to be used in the rare case that the RNG oracle kills a job for a pack unboxing
 * due to issues with the finisher script.
+* If multiple packs were opened with a single transfer, the asset id of the first pack needs to be used.
 *
 * @required_auth The contract itself
 */
@@ -32,29 +34,14 @@ ACTION atomicpacks::retryrand(
 ) {
     require_auth(get_self());
 
-    unboxpacks.require_find(pack_asset_id,
-        "No open unboxpacks entry with the specified pack asset id exists");
+    unboxpacks_s unboxpack = get_unboxpack(pack_asset_id);
     
     unboxassets_t unboxassets = get_unboxassets(pack_asset_id);
-    check(unboxassets.begin() == unboxassets.end(),
+    check(unboxassets.begin() == unboxassets.end() && unboxresults.find(pack_asset_id) == unboxresults.end()
+        && !unboxpack.unbox_seed.has_value(),
         "The specified pack asset id already has results");
 
-    //Get signing value from transaction id
-    //As this is only used as the signing value for the randomness oracle, it does not matter that this
-    //signing value is not truly random
-    size_t size = transaction_size();
-    char buf[size];
-    uint32_t read = read_transaction(buf, size);
-    check(size == read, "Signing value generation: read_transaction() has failed.");
-    checksum256 tx_id = eosio::sha256(buf, read);
-    uint64_t signing_value;
-    memcpy(&signing_value, tx_id.data(), sizeof(signing_value));
-
-    //Check if the signing_value was already used.
-    //If that is the case, increment the signing_value until a non-used value is found
-    while (orng::signvals.find(signing_value) != orng::signvals.end()) {
-        signing_value++;
-    }
+    uint64_t signing_value = get_signing_value(pack_asset_id);
 
     action(
         permission_level{get_self(), name("active")},
@@ -137,10 +124,116 @@ void atomicpacks::check_has_collection_auth(
 }
 
 
+/**
+* Internal function to get an unused signing value for a randomness request
+*
+* As this is only used as the signing value for the randomness oracle, it does not matter that this
+* signing value is not truly random, it only needs to be unused. It is therefore derived from a contract-local
+* counter mixed with the tapos block prefix and the assoc id, instead of hashing the whole transaction.
+* If the value was already used, a bounded number of other well distributed values are probed
+*/
+uint64_t atomicpacks::get_signing_value(uint64_t assoc_id) {
+    config_s current_config = config.get_or_default();
+    uint64_t counter = current_config.signing_value_counter++;
+    config.set(current_config, get_self());
+
+    auto mix = [](uint64_t value) {
+        //splitmix64 finalizer
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+        return value ^ (value >> 31);
+    };
+
+    uint64_t signing_value = mix(counter ^ mix(((uint64_t) tapos_block_prefix() << 32) ^ assoc_id));
+
+    for (int probe = 0; probe < MAX_SIGNING_VALUE_PROBES; probe++) {
+        if (orng::signvals.find(signing_value) == orng::signvals.end()) {
+            return signing_value;
+        }
+        signing_value = mix(signing_value + 0x9e3779b97f4a7c15);
+    }
+
+    check(false, "Signing value generation: Unable to find an unused signing value");
+    return 0;
+}
+
+
+/**
+* Internal function to calculate the unbox profile of a pack by going through all of its rolls
+*/
+atomicpacks::UNBOX_PROFILE atomicpacks::build_unbox_profile(
+    uint64_t pack_id,
+    uint32_t unbox_flags
+) {
+    UNBOX_PROFILE unbox_profile = {
+        .roll_count = 0,
+        .reserved_ram_bytes = 0,
+        .can_mint = false
+    };
+
+    packrolls_t packrolls = get_packrolls(pack_id);
+    for (const packrolls_s &roll : packrolls) {
+        unbox_profile.roll_count += roll.count.value_or(1);
+        for (const OUTCOME &outcome : get_roll_outcomes(roll)) {
+            unbox_profile.can_mint = unbox_profile.can_mint || outcome.template_id != -1;
+        }
+    }
+
+    int64_t roll_count = unbox_profile.roll_count;
+
+    if (unbox_flags & UNBOX_FLAG_DIRECT_MINT) {
+        //This amount of RAM will be needed to mint the assets when the randomness is received
+        //The asset table scope of the unboxer and a minimum size asset for each roll
+        unbox_profile.reserved_ram_bytes = unbox_profile.can_mint ? SCOPE_BYTES + roll_count * MIN_ASSET_ROW_BYTES : 0;
+    } else if (unbox_flags & UNBOX_FLAG_PACKED_RESULTS) {
+        //This amount of RAM will be needed for the unboxresults row when the randomness is received
+        unbox_profile.reserved_ram_bytes = get_unboxresults_ram_bytes(roll_count);
+    } else if (unbox_flags & UNBOX_FLAG_DEFERRED_RESULTS) {
+        //The seed and the claimed rolls bitmap are added to the unboxpacks entry when the randomness is received
+        unbox_profile.reserved_ram_bytes = get_unbox_seed_ram_bytes(roll_count);
+    } else {
+        //This amount of RAM will be needed to fill the unboxassets table when the randomness is received
+        //The unboxassets scope and an unboxassets row for each roll
+        unbox_profile.reserved_ram_bytes = SCOPE_BYTES + roll_count * UNBOXASSETS_ROW_BYTES;
+    }
+
+    unbox_profile.reserved_ram_bytes += unbox_flags & UNBOX_FLAG_LEAN_UNBOXPACKS
+        ? LEAN_UNBOXPACKS_ROW_BYTES
+        : UNBOXPACKS_ROW_BYTES;
+
+    if (!(unbox_flags & UNBOX_FLAG_DEFERRED_RESULTS) && unbox_profile.roll_count > MAX_UNBOX_DRAWS_PER_STEP) {
+        //The progress is stored in the unboxcursors table while the pack is unboxed in multiple steps
+        unbox_profile.reserved_ram_bytes += UNBOXCURSORS_ROW_BYTES;
+    }
+
+    return unbox_profile;
+}
+
+
+/**
+* Internal function to get the unbox profile of a completed pack
+* Packs that were completed before unbox profiles were introduced don't have one, so it is calculated instead
+*/
+atomicpacks::UNBOX_PROFILE atomicpacks::get_unbox_profile(
+    const packs_s &pack
+) {
+    if (pack.unbox_profile.has_value()) {
+        return pack.unbox_profile.value();
+    }
+
+    return build_unbox_profile(pack.pack_id, pack.unbox_flags.value_or(0));
+}
+
+
 atomicpacks::packrolls_t atomicpacks::get_packrolls(uint64_t pack_id) {
     return packrolls_t(get_self(), pack_id);
 }
 
+atomicpacks::bundlechunks_t atomicpacks::get_bundlechunks(uint64_t pack_id) {
+    return bundlechunks_t(get_self(), pack_id);
+}
+
+
 atomicpacks::unboxassets_t atomicpacks::get_unboxassets(uint64_t pack_asset_id) {
     return unboxassets_t(get_self(), pack_asset_id);
 }
\ No newline at end of file
@@ -52,6 +52,9 @@ ACTION atomicpacks::announcepack(
 * The summed odds must equal 1
 * 
 * Each roll can be seen at one random chance at unboxing an NFT
+* The optional count makes the roll be drawn count times. The roll then uses count consecutive roll ids,
+* which are used as the origin roll ids of the results
+* The outcomes are stored in a compact encoding if that is smaller, see encode_outcomes
 * 
 * @required_auth authorized_account, who must be authorized within the collection that the pack belongs to
 */
@@ -59,7 +62,8 @@ ACTION atomicpacks::addpackroll(
     name authorized_account,
     uint64_t pack_id,
     vector <OUTCOME> outcomes,
-    uint32_t total_odds
+    uint32_t total_odds,
+    binary_extension <uint32_t> count
 ) {
     require_auth(authorized_account);
 
@@ -70,46 +74,34 @@ ACTION atomicpacks::addpackroll(
     check(pack_itr->pack_template_id == -1, "The pack has already been completed");
 
 
-    check(outcomes.size() != 0, "A roll must include at least one outcome");
-
+    check(count.value_or(1) != 0, "The count of a roll must be positive");
 
     atomicassets::templates_t col_templates = atomicassets::get_templates(pack_itr->collection_name);
-
-    uint32_t total_counted_odds = 0;
-    uint32_t last_odds = UINT_MAX;
-
-    for (OUTCOME outcome : outcomes) {
-        check(outcome.odds > 0, "Each outcome must have positive odds");
-        check(outcome.odds <= last_odds,
-            "The outcomes must be sorted in descending order based on their odds");
-        last_odds = outcome.odds;
-
-        total_counted_odds += outcome.odds;
-        check(total_counted_odds >= outcome.odds, "Overflow: Total odds can't be more than 2^32 - 1");
-
-        if (outcome.template_id != -1) {
-            auto template_itr = col_templates.require_find(outcome.template_id,
-                ("At least one template id of an outcome does not exist within the collection: " +
-                 to_string(outcome.template_id)).c_str());
-            check(template_itr->max_supply == 0, "Can only use templates without a max supply");
-        }
-    }
-
-    check(total_counted_odds == total_odds,
-        "The total odds of the outcomes deos not equal the provided total odds");
+    set <int32_t> validated_template_ids = {};
+    check_roll_outcomes(outcomes, total_odds, col_templates, validated_template_ids);
 
 
     uint64_t roll_id = pack_itr->roll_counter;
 
     packs.modify(pack_itr, same_payer, [&](auto &_pack) {
-        _pack.roll_counter++;
+        _pack.roll_counter += count.value_or(1);
     });
 
+    vector <uint8_t> packed_outcomes = encode_outcomes(outcomes, count.has_value());
+
     packrolls_t packrolls = get_packrolls(pack_id);
     packrolls.emplace(authorized_account, [&](auto &_roll) {
         _roll.roll_id = roll_id;
-        _roll.outcomes = outcomes;
         _roll.total_odds = total_odds;
+        if (packed_outcomes.empty()) {
+            _roll.outcomes = outcomes;
+            if (count.has_value()) {
+                _roll.count.emplace(count.value());
+            }
+        } else {
+            _roll.count.emplace(count.value_or(1));
+            _roll.packed_outcomes.emplace(packed_outcomes);
+        }
     });
 
 
@@ -125,6 +117,75 @@ ACTION atomicpacks::addpackroll(
 }
 
 
+/**
+* Adds multiple rolls to a pack
+* This works the same way as calling addpackroll for each of the rolls, but each distinct template
+* is only validated once and only a single lognewrolls action is sent
+* 
+* @required_auth authorized_account, who must be authorized within the collection that the pack belongs to
+*/
+ACTION atomicpacks::addpackrolls(
+    name authorized_account,
+    uint64_t pack_id,
+    vector <ROLL_DATA> rolls
+) {
+    require_auth(authorized_account);
+
+    auto pack_itr = packs.require_find(pack_id, "No pack with this id exists");
+
+    check_has_collection_auth(authorized_account, pack_itr->collection_name);
+
+    check(pack_itr->pack_template_id == -1, "The pack has already been completed");
+
+    check(rolls.size() != 0, "The rolls vector can't be empty");
+
+
+    atomicassets::templates_t col_templates = atomicassets::get_templates(pack_itr->collection_name);
+    set <int32_t> validated_template_ids = {};
+
+    packrolls_t packrolls = get_packrolls(pack_id);
+
+    uint64_t roll_id = pack_itr->roll_counter;
+    vector <uint64_t> roll_ids = {};
+
+    for (const ROLL_DATA &roll : rolls) {
+        check(roll.count != 0, "The count of a roll must be positive");
+        check_roll_outcomes(roll.outcomes, roll.total_odds, col_templates, validated_template_ids);
+
+        vector <uint8_t> packed_outcomes = encode_outcomes(roll.outcomes, true);
+
+        packrolls.emplace(authorized_account, [&](auto &_roll) {
+            _roll.roll_id = roll_id;
+            _roll.total_odds = roll.total_odds;
+            _roll.count.emplace(roll.count);
+            if (packed_outcomes.empty()) {
+                _roll.outcomes = roll.outcomes;
+            } else {
+                _roll.packed_outcomes.emplace(packed_outcomes);
+            }
+        });
+
+        roll_ids.push_back(roll_id);
+        roll_id += roll.count;
+    }
+
+    packs.modify(pack_itr, same_payer, [&](auto &_pack) {
+        _pack.roll_counter = roll_id;
+    });
+
+
+    action(
+        permission_level{get_self(), name("active")},
+        get_self(),
+        name("lognewrolls"),
+        std::make_tuple(
+            pack_id,
+            roll_ids
+        )
+    ).send();
+}
+
+
 /**
 * Deletes a roll
 * 
@@ -157,13 +218,27 @@ ACTION atomicpacks::delpackroll(
 * to this template is then viewed as a pack that can be unboxed
 * 
 * After a pack is completed, no new rolls can be added and no existing rolls can be erased
+* An alias table is built for each roll, so that outcomes can be drawn in constant time when unboxing
+* The alias tables are stored in bundlechunks rows of MAX_UNBOX_DRAWS_PER_STEP draws each, so that an unbox step
+* only reads the chunk it draws from. The packbundles row of the pack holds a hash over all chunks
+*
+* The optional unbox flags change how the pack is unboxed. With UNBOX_FLAG_DIRECT_MINT, the results
+* are minted immediately when the randomness is received instead of having to be claimed
+* With UNBOX_FLAG_PACKED_RESULTS, all results are stored in a single unboxresults row instead of one
+* unboxassets row per roll
+* With UNBOX_FLAG_LEAN_UNBOXPACKS, opened packs are stored in the leanunboxes table, which does not have
+* the unboxer index of the unboxpacks table
+* With UNBOX_FLAG_DEFERRED_RESULTS, only the random seed is stored when the randomness is received, and the
+* results are drawn again from that seed whenever rolls are claimed. This is limited to packs with at most
+* MAX_UNBOX_DRAWS_PER_STEP rolls, because claiming always draws all rolls in one action
 * 
 * @required_auth authorized_account, who must be authorized within the collection that the pack belongs to
 */
 ACTION atomicpacks::completepack(
     name authorized_account,
     uint64_t pack_id,
-    int32_t pack_template_id
+    int32_t pack_template_id,
+    binary_extension <uint32_t> unbox_flags
 ) {
     require_auth(authorized_account);
 
@@ -177,6 +252,28 @@ ACTION atomicpacks::completepack(
     packrolls_t packrolls = get_packrolls(pack_id);
     check(packrolls.begin() != packrolls.end(), "The pack does not have any rolls");
 
+    uint32_t flags = unbox_flags.value_or(0);
+    check((flags & ~SUPPORTED_UNBOX_FLAGS) == 0, "Unsupported unbox flags");
+    check(!(flags & UNBOX_FLAG_DIRECT_MINT) || !(flags & UNBOX_FLAG_PACKED_RESULTS),
+        "Packs with direct minting don't store any results, so they can't use packed results");
+    check(!(flags & UNBOX_FLAG_DEFERRED_RESULTS) || !(flags & (UNBOX_FLAG_DIRECT_MINT | UNBOX_FLAG_PACKED_RESULTS)),
+        "Packs with deferred results only store the seed, so they can't use direct minting or packed results");
+
+    //The unbox profile is frozen, so that opening the pack doesn't require going through the rolls
+    UNBOX_PROFILE unbox_profile = build_unbox_profile(pack_id, flags);
+
+    if (flags & UNBOX_FLAG_DIRECT_MINT) {
+        check(unbox_profile.roll_count <= MAX_DIRECT_MINT_ROLLS,
+            "Direct minting is only possible for packs with at most " + to_string(MAX_DIRECT_MINT_ROLLS) + " rolls");
+    }
+
+    if (flags & UNBOX_FLAG_DEFERRED_RESULTS) {
+        //All rolls are drawn again every time a roll is claimed, which can't be split into multiple steps
+        check(unbox_profile.roll_count <= MAX_UNBOX_DRAWS_PER_STEP,
+            "Deferred results are only possible for packs with at most " + to_string(MAX_UNBOX_DRAWS_PER_STEP)
+            + " rolls");
+    }
+
 
     check(pack_template_id > 0, "The tempalte id must be positive");
     atomicassets::templates_t col_templates = atomicassets::get_templates(pack_itr->collection_name);
@@ -190,8 +287,59 @@ ACTION atomicpacks::completepack(
     check(packs_by_template_id.find(pack_template_id) == packs_by_template_id.end(),
         "Another pack is already using this template id");
 
-    packs.modify(pack_itr, same_payer, [&](auto &_pack) {
+    //The rolls can't be modified anymore after completing the pack, so the alias tables used for
+    //drawing the outcomes at unbox time are built once here
+    vector <bundlechunks_s> chunks = {{.first_roll_id = 0}};
+    uint64_t chunk_draws = 0;
+    uint64_t next_roll_id = 0;
+
+    for (const packrolls_s &roll : packrolls) {
+        vector <uint8_t> alias_table = encode_alias_table(
+            build_alias_table(get_roll_outcomes(roll), roll.total_odds), roll.total_odds);
+
+        uint32_t count = roll.count.value_or(1);
+        for (uint32_t drawn = 0; drawn < count;) {
+            if (chunk_draws == MAX_UNBOX_DRAWS_PER_STEP) {
+                chunks.push_back({.first_roll_id = next_roll_id});
+                chunk_draws = 0;
+            }
+
+            uint32_t chunk_count = std::min <uint64_t>(count - drawn, MAX_UNBOX_DRAWS_PER_STEP - chunk_draws);
+            chunks.back().rolls.push_back({
+                .roll_id = roll.roll_id + drawn,
+                .count = chunk_count,
+                .total_odds = roll.total_odds,
+                .alias_table = alias_table
+            });
+
+            drawn += chunk_count;
+            chunk_draws += chunk_count;
+            next_roll_id = roll.roll_id + drawn;
+        }
+    }
+    chunks.back().last_chunk = true;
+
+    bundlechunks_t bundlechunks = get_bundlechunks(pack_id);
+    vector <char> bundle_data = {};
+    for (const bundlechunks_s &chunk : chunks) {
+        bundlechunks.emplace(authorized_account, [&](auto &_chunk) {
+            _chunk = chunk;
+        });
+
+        vector <char> chunk_data = eosio::pack(chunk);
+        bundle_data.insert(bundle_data.end(), chunk_data.begin(), chunk_data.end());
+    }
+
+    packbundles.emplace(authorized_account, [&](auto &_packbundle) {
+        _packbundle.pack_id = pack_id;
+        _packbundle.num_chunks = chunks.size();
+        _packbundle.content_hash = eosio::sha256(bundle_data.data(), bundle_data.size());
+    });
+
+    packs.modify(pack_itr, authorized_account, [&](auto &_pack) {
         _pack.pack_template_id = pack_template_id;
+        _pack.unbox_flags.emplace(flags);
+        _pack.unbox_profile.emplace(unbox_profile);
     });
 }
 
@@ -251,4 +399,63 @@ ACTION atomicpacks::lognewroll(
     uint64_t roll_id
 ) {
     require_auth(get_self());
+}
+
+
+ACTION atomicpacks::lognewrolls(
+    uint64_t pack_id,
+    vector <uint64_t> roll_ids
+) {
+    require_auth(get_self());
+}
+
+
+/**
+* Internal function to check that the outcomes of a roll are valid
+* The template ids that have already been validated are skipped, and newly validated ones are added
+*/
+void atomicpacks::check_roll_outcomes(
+    const vector <OUTCOME> &outcomes,
+    uint32_t total_odds,
+    atomicassets::templates_t &col_templates,
+    set <int32_t> &validated_template_ids
+) {
+    check(outcomes.size() != 0, "A roll must include at least one outcome");
+
+    uint32_t total_counted_odds = 0;
+    uint32_t last_odds = UINT_MAX;
+
+    for (const OUTCOME &outcome : outcomes) {
+        check(outcome.odds > 0, "Each outcome must have positive odds");
+        check(outcome.odds <= last_odds,
+            "The outcomes must be sorted in descending order based on their odds");
+        last_odds = outcome.odds;
+
+        total_counted_odds += outcome.odds;
+        check(total_counted_odds >= outcome.odds, "Overflow: Total odds can't be more than 2^32 - 1");
+
+        if (outcome.template_id != -1 && validated_template_ids.insert(outcome.template_id).second) {
+            auto template_itr = col_templates.require_find(outcome.template_id,
+                ("At least one template id of an outcome does not exist within the collection: " +
+                 to_string(outcome.template_id)).c_str());
+            check(template_itr->max_supply == 0, "Can only use templates without a max supply");
+        }
+    }
+
+    check(total_counted_odds == total_odds,
+        "The total odds of the outcomes deos not equal the provided total odds");
+}
+
+
+/**
+* Internal function to get the outcomes of a roll, decoding them if they are stored in a compact encoding
+*/
+vector <OUTCOME> atomicpacks::get_roll_outcomes(
+    const packrolls_s &roll
+) {
+    if (!roll.packed_outcomes.has_value() || roll.packed_outcomes.value().empty()) {
+        return roll.outcomes;
+    }
+
+    return decode_outcomes(roll.packed_outcomes.value());
 }
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include <atomicpacks.hpp>
+
+#include <cmath>
+
+
+/**
+* Returns the odds of each template that can be unboxed from a pack, aggregated over all of its rolls
+* The template id -1 (no asset) is included as well
+*
+* Read only, meant to be called by clients instead of reading all packrolls rows of the pack
+*/
+vector <atomicpacks::TEMPLATE_ODDS> atomicpacks::getpackodds(
+    uint64_t pack_id
+) {
+    packs.require_find(pack_id, "No pack with this id exists");
+
+    map <int32_t, TEMPLATE_ODDS> template_odds = {};
+
+    packrolls_t packrolls = get_packrolls(pack_id);
+    for (const packrolls_s &roll : packrolls) {
+        uint32_t count = roll.count.value_or(1);
+
+        for (const OUTCOME &outcome : get_roll_outcomes(roll)) {
+            double roll_probability = (double) outcome.odds / roll.total_odds;
+
+            auto odds_itr = template_odds.find(outcome.template_id);
+            if (odds_itr == template_odds.end()) {
+                odds_itr = template_odds.insert({outcome.template_id, {
+                    .template_id = outcome.template_id,
+                    .expected_count = 0,
+                    .probability = 0
+                }}).first;
+            }
+
+            //The draws are independent, so a pack misses the template only if every single draw misses it
+            odds_itr->second.expected_count += count * roll_probability;
+            odds_itr->second.probability = 1 - (1 - odds_itr->second.probability) * pow(1 - roll_probability, count);
+        }
+    }
+
+    vector <TEMPLATE_ODDS> result = {};
+    for (const auto &[template_id, odds] : template_odds) {
+        result.push_back(odds);
+    }
+    return result;
+}
+
+
+/**
+* Returns the number of rolls, the expected number of minted assets and the RAM costs of opening a pack
+* For packs that have not been completed yet, the costs are those of a pack without any unbox flags
+*
+* Read only, meant to be called by clients instead of reading all packrolls rows of the pack
+*/
+atomicpacks::UNBOX_COST atomicpacks::getunboxcost(
+    uint64_t pack_id
+) {
+    auto pack_itr = packs.require_find(pack_id, "No pack with this id exists");
+
+    double expected_mint_count = 0;
+
+    packrolls_t packrolls = get_packrolls(pack_id);
+    for (const packrolls_s &roll : packrolls) {
+        uint64_t minting_odds = 0;
+        for (const OUTCOME &outcome : get_roll_outcomes(roll)) {
+            if (outcome.template_id != -1) {
+                minting_odds += outcome.odds;
+            }
+        }
+        expected_mint_count += (double) roll.count.value_or(1) * minting_odds / roll.total_odds;
+    }
+
+    UNBOX_PROFILE unbox_profile = pack_itr->pack_template_id != -1
+        ? get_unbox_profile(*pack_itr)
+        : build_unbox_profile(pack_id, 0);
+
+    return {
+        .roll_count = unbox_profile.roll_count,
+        .expected_mint_count = expected_mint_count,
+        .reserved_ram_bytes = unbox_profile.reserved_ram_bytes,
+        .request_ram_bytes = ORNG_SIGNVALS_ROW_BYTES + ORNG_JOBS_ROW_BYTES,
+        .expected_mint_ram_bytes = expected_mint_count * MIN_ASSET_ROW_BYTES
+    };
+}
+
+
+/**
+* Returns the results that unboxing a pack would give if receiverand was called with the specified seed
+* For packs opened together with other packs, the seed of each pack is derived from the random value
+* as described in receiverand
+*
+* Read only, meant to be called by clients to preview or verify unboxing results
+*/
+vector <atomicpacks::UNBOX_RESULT> atomicpacks::previewunbox(
+    uint64_t pack_id,
+    checksum256 seed
+) {
+    auto pack_itr = packs.require_find(pack_id, "No pack with this id exists");
+    check(pack_itr->pack_template_id != -1, "The pack has not been completed yet");
+
+    vector <uint64_t> result_roll_ids = {};
+    vector <int32_t> result_template_ids = {};
+    uint64_t rand_position = 0;
+    draw_unbox_results(pack_id, seed, rand_position, 0, get_unbox_profile(*pack_itr).roll_count,
+        result_roll_ids, result_template_ids);
+
+    vector <UNBOX_RESULT> results = {};
+    for (size_t i = 0; i < result_roll_ids.size(); i++) {
+        results.push_back({
+            .origin_roll_id = result_roll_ids[i],
+            .template_id = result_template_ids[i]
+        });
+    }
+    return results;
+}
@@ -112,8 +112,18 @@ ACTION atomicpacks::buyramproxy(
 }
 
 
+/**
+* Changes to the RAM balances of collections are collected in a ledger during an action and only written
+* to the rambalances table once the action ends, so that each rambalances row is written at most once
+*/
+atomicpacks::~atomicpacks() {
+    settle_collection_ram_balances();
+}
+
+
 /**
 * Internal function to increase the ram balance of a collection
+* The change is recorded in the ledger and written when the action ends
 */
 void atomicpacks::increase_collection_ram_balance(
     name collection_name,
@@ -121,23 +131,13 @@ void atomicpacks::increase_collection_ram_balance(
 ) {
     check(bytes > 0, "increase balance bytes must be positive");
 
-    auto itr = rambalances.find(collection_name.value);
-    if (itr == rambalances.end()) {
-        check(bytes >= 128, "Must inrease the collection ram balance by at least 128 to pay for the table entry");
-        rambalances.emplace(get_self(), [&](auto &_colbalance) {
-            _colbalance.collection_name = collection_name;
-            _colbalance.byte_balance = bytes - 128;
-        });
-    } else {
-        rambalances.modify(itr, same_payer, [&](auto &_colbalance) {
-            _colbalance.byte_balance += bytes;
-        });
-    }
+    ram_balance_deltas[collection_name].bytes += bytes;
 }
 
 
 /**
 * Internal function to decrease the ram balance of a collection
+* The change is recorded in the ledger and written when the action ends
 * Throws if the collection does not have enough balance
 */
 void atomicpacks::decrease_collection_ram_balance(
@@ -147,10 +147,48 @@ void atomicpacks::decrease_collection_ram_balance(
 ) {
     check(bytes > 0, "decrease balance bytes must be positive");
 
-    auto itr = rambalances.find(collection_name.value);
-    check(itr != rambalances.end() && itr->byte_balance >= bytes, error_message);
+    RAM_BALANCE_DELTA &delta = ram_balance_deltas[collection_name];
+    delta.bytes -= bytes;
+    delta.error_message = error_message;
+
+    //Fail early instead of only when the action ends, the balance is checked again when settling
+    if (delta.bytes < 0) {
+        auto itr = rambalances.find(collection_name.value);
+        check(itr != rambalances.end() && itr->byte_balance >= -delta.bytes, error_message);
+    }
+}
+
+
+/**
+* Internal function to write the collected RAM balance changes to the rambalances table
+* Throws if a collection does not have enough balance for the net decrease of its balance
+*/
+void atomicpacks::settle_collection_ram_balances() {
+    for (const auto &[collection_name, delta] : ram_balance_deltas) {
+        if (delta.bytes == 0) {
+            continue;
+        }
+
+        auto itr = rambalances.find(collection_name.value);
+        if (delta.bytes < 0) {
+            check(itr != rambalances.end() && itr->byte_balance >= -delta.bytes, delta.error_message);
+
+            rambalances.modify(itr, same_payer, [&](auto &_colbalance) {
+                _colbalance.byte_balance += delta.bytes;
+            });
+        } else if (itr == rambalances.end()) {
+            check(delta.bytes >= RAMBALANCES_ROW_BYTES, "Must inrease the collection ram balance by at least " +
+                to_string(RAMBALANCES_ROW_BYTES) + " to pay for the table entry");
+            rambalances.emplace(get_self(), [&](auto &_colbalance) {
+                _colbalance.collection_name = collection_name;
+                _colbalance.byte_balance = delta.bytes - RAMBALANCES_ROW_BYTES;
+            });
+        } else {
+            rambalances.modify(itr, same_payer, [&](auto &_colbalance) {
+                _colbalance.byte_balance += delta.bytes;
+            });
+        }
+    }
 
-    rambalances.modify(itr, same_payer, [&](auto &_colbalance) {
-        _colbalance.byte_balance -= bytes;
-    });
+    ram_balance_deltas.clear();
 }
\ No newline at end of file
@@ -1,34 +1,87 @@
+/**
+* Provides a deterministic stream of random values derived from a random seed
+*
+* The stream is generated in counter mode: block i is sha256(seed || i), which means that any position of the
+* stream can be derived from the seed alone. Each block is consumed 8 bytes at a time.
+* The position in the stream (the number of 64 bit values taken so far) can be stored and used to resume the stream later
+* Bounded values are generated without modulo bias using Lemire's multiply and reject method
+*/
 class RandomnessProvider {
 public:
-    RandomnessProvider(checksum256 random_seed) {
-        raw_values = random_seed.extract_as_byte_array();
-        offset = 0;
+    RandomnessProvider(checksum256 random_seed, uint64_t position = 0) {
+        array <uint8_t, 32> seed_bytes = random_seed.extract_as_byte_array();
+        memcpy(block_input.data(), seed_bytes.data(), 32);
+        counter = position / 4;
+        offset = 32;
+
+        if (position % 4 != 0) {
+            generate_next_block();
+            offset = (position % 4) * 8;
+        }
+    }
+
+    uint64_t get_position() const {
+        return counter * 4 - (32 - offset) / 8;
     }
 
     uint64_t get_uint64() {
         if (offset > 24) {
-            regenerate_raw_values();
+            generate_next_block();
         }
 
-        uint64_t value = 0;
-        for (int i = 0; i < 8; i++) {
-            value = (value << 8) + raw_values[offset];
-            offset++;
-        }
+        uint64_t value;
+        memcpy(&value, block.data() + offset, sizeof(value));
+        offset += sizeof(value);
         return value;
     }
 
     uint32_t get_rand(uint32_t max_value) {
-        return get_uint64() % ((uint64_t) max_value);
+        return (uint32_t) get_rand_uint64(max_value);
+    }
+
+    uint64_t get_rand_uint64(uint64_t max_value) {
+        //Powers of two (including 1) divide the range of uint64_t evenly
+        if ((max_value & (max_value - 1)) == 0) {
+            return get_uint64() & (max_value - 1);
+        }
+
+        unsigned __int128 product = (unsigned __int128) get_uint64() * max_value;
+        uint64_t low_bits = (uint64_t) product;
+
+        if (low_bits < max_value) {
+            //Values in the range [0, 2^64 mod max_value) would otherwise be drawn once more than the others
+            uint64_t threshold = (0 - max_value) % max_value;
+            while (low_bits < threshold) {
+                product = (unsigned __int128) get_uint64() * max_value;
+                low_bits = (uint64_t) product;
+            }
+        }
+
+        return (uint64_t) (product >> 64);
+    }
+
+    /**
+    * Draws one value for each of the bounds, values[i] being in the range [0, bounds[i])
+    * The values are the same as when calling get_rand_uint64 for each bound in order
+    */
+    void fill(vector <uint64_t> &values, const vector <uint64_t> &bounds) {
+        values.resize(bounds.size());
+        for (size_t i = 0; i < bounds.size(); i++) {
+            values[i] = get_rand_uint64(bounds[i]);
+        }
     }
 
 private:
-    void regenerate_raw_values() {
-        checksum256 new_hash = eosio::sha256((char *) raw_values.data(), 32);
-        raw_values = new_hash.extract_as_byte_array();
+    void generate_next_block() {
+        memcpy(block_input.data() + 32, &counter, sizeof(counter));
+        checksum256 new_hash = eosio::sha256((char *) block_input.data(), block_input.size());
+        block = new_hash.extract_as_byte_array();
+        counter++;
         offset = 0;
     }
 
-    array<uint8_t, 32> raw_values;
+    array <uint8_t, 40> block_input;
+    array <uint8_t, 32> block;
+    uint64_t counter;
     int offset;
-};
\ No newline at end of file
+};
@@ -6,7 +6,10 @@
 /**
 * Claims one or more rolls from an unboxed pack.
 * Claiming a roll can either mean that a new asset is minted if the template id is not -1
-* or simply removing the row from the unboxassets table if the template id is -1
+* or simply removing the row from the unboxassets table (or the result from the unboxresults row)
+* if the template id is -1
+* For packs with deferred results, the results are drawn again from the stored seed and the claimed rolls
+* are marked in the bitmap of the unboxpacks entry
 *
 * @required_auth The unboxer of the pack
 */
@@ -14,77 +17,125 @@ ACTION atomicpacks::claimunboxed(
     uint64_t pack_asset_id,
     vector <uint64_t> origin_roll_ids
 ) {
-    auto unboxpack_itr = unboxpacks.require_find(pack_asset_id,
-        "No unboxpack with this pack asset id exists");
+    unboxpacks_s unboxpack = get_unboxpack(pack_asset_id);
 
-    check(has_auth(unboxpack_itr->unboxer) || has_auth(get_self()),
+    check(has_auth(unboxpack.unboxer) || has_auth(get_self()),
         "The transaction needs to be authorized either by the unboxer or by the contract itself");
 
     check(origin_roll_ids.size() != 0, "The original roll ids vector can't be empty");
 
-    auto pack_itr = packs.find(unboxpack_itr->pack_id);
+    check(unboxcursors.find(pack_asset_id) == unboxcursors.end(),
+        "The pack is unboxed in multiple steps and not all rolls have been drawn yet");
 
+    auto pack_itr = packs.find(unboxpack.pack_id);
 
-    atomicassets::templates_t col_templates = atomicassets::get_templates(pack_itr->collection_name);
-
-    unboxassets_t unboxassets = get_unboxassets(pack_asset_id);
 
     int64_t ram_cost_delta = 0;
     bool mint_at_least_one = false;
+    bool claimed_all = false;
+
+    if (pack_itr->unbox_flags.value_or(0) & UNBOX_FLAG_DEFERRED_RESULTS) {
+        vector <UNBOX_RESULT> results = get_deferred_results(pack_asset_id, unboxpack);
+        UNBOX_SEED unbox_seed = unboxpack.unbox_seed.value();
+
+        for (uint64_t roll_id : origin_roll_ids) {
+            //The results are sorted by their origin roll ids
+            auto result_itr = std::lower_bound(results.begin(), results.end(), roll_id,
+                [](const UNBOX_RESULT &result, uint64_t value) {
+                    return result.origin_roll_id < value;
+                });
+            size_t index = result_itr - results.begin();
+            check(result_itr != results.end() && result_itr->origin_roll_id == roll_id
+                && !(unbox_seed.claimed_rolls[index / 8] & (1 << (index % 8))),
+                "No unbox asset with the origin roll id " + to_string(roll_id) + " exists");
+
+            if (mint_unboxed_template(pack_itr->collection_name, unboxpack.unboxer,
+                result_itr->template_id)) {
+                mint_at_least_one = true;
+                ram_cost_delta += MIN_ASSET_ROW_BYTES;
+            }
+
+            unbox_seed.claimed_rolls[index / 8] |= 1 << (index % 8);
+        }
+
+        claimed_all = true;
+        for (size_t index = 0; index < results.size(); index++) {
+            claimed_all = claimed_all && (unbox_seed.claimed_rolls[index / 8] & (1 << (index % 8)));
+        }
+
+        if (!claimed_all) {
+            //The size of the bitmap does not change, so no RAM is freed until all rolls are claimed
+            set_unbox_seed(pack_asset_id, unbox_seed);
+        }
+
+    } else if (pack_itr->unbox_flags.value_or(0) & UNBOX_FLAG_PACKED_RESULTS) {
+        auto unboxresults_itr = unboxresults.require_find(pack_asset_id,
+            "The results of this pack have not been received yet");
+
+        vector <UNBOX_RESULT> results = unboxresults_itr->results;
 
-    for (uint64_t roll_id : origin_roll_ids) {
-        auto unboxasset_itr = unboxassets.require_find(roll_id,
-            ("No unbox asset with the origin roll id " + to_string(roll_id) + " exists").c_str());
-
-        //Template -1 means no asset will be created
-        if (unboxasset_itr->template_id != -1) {
-            auto template_itr = col_templates.find(unboxasset_itr->template_id);
-
-            //Templates with maximum supply are not supported
-            //Templates are guaranteed not to have a maximum supply when the packs are created
-            //however the template could be locked later, in which case it is skipped here
-            if (template_itr->max_supply == 0) {
-
-                action(
-                    permission_level{get_self(), name("active")},
-                    atomicassets::ATOMICASSETS_ACCOUNT,
-                    name("mintasset"),
-                    make_tuple(
-                        get_self(),
-                        pack_itr->collection_name,
-                        template_itr->schema_name,
-                        template_itr->template_id,
-                        unboxpack_itr->unboxer,
-                        (atomicassets::ATTRIBUTE_MAP) {},
-                        (atomicassets::ATTRIBUTE_MAP) {},
-                        (vector <asset>) {}
-                    )
-                ).send();
+        for (uint64_t roll_id : origin_roll_ids) {
+            auto result_itr = std::find_if(results.begin(), results.end(), [&](const UNBOX_RESULT &result) {
+                return result.origin_roll_id == roll_id;
+            });
+            check(result_itr != results.end(),
+                "No unbox asset with the origin roll id " + to_string(roll_id) + " exists");
 
+            if (mint_unboxed_template(pack_itr->collection_name, unboxpack.unboxer,
+                result_itr->template_id)) {
                 mint_at_least_one = true;
-                //Minimum size asset = 151
-                ram_cost_delta += 151;
+                ram_cost_delta += MIN_ASSET_ROW_BYTES;
+            }
+
+            results.erase(result_itr);
+        }
+
+        ram_cost_delta -= get_unboxresults_ram_bytes(unboxresults_itr->results.size());
+        claimed_all = results.empty();
+
+        if (claimed_all) {
+            unboxresults.erase(unboxresults_itr);
+        } else {
+            unboxresults.modify(unboxresults_itr, same_payer, [&](auto &_unboxresult) {
+                _unboxresult.results = results;
+            });
+            ram_cost_delta += get_unboxresults_ram_bytes(results.size());
+        }
+
+    } else {
+        unboxassets_t unboxassets = get_unboxassets(pack_asset_id);
+
+        for (uint64_t roll_id : origin_roll_ids) {
+            auto unboxasset_itr = unboxassets.require_find(roll_id,
+                ("No unbox asset with the origin roll id " + to_string(roll_id) + " exists").c_str());
 
+            if (mint_unboxed_template(pack_itr->collection_name, unboxpack.unboxer,
+                unboxasset_itr->template_id)) {
+                mint_at_least_one = true;
+                ram_cost_delta += MIN_ASSET_ROW_BYTES;
             }
+
+            unboxassets.erase(unboxasset_itr);
+            ram_cost_delta -= UNBOXASSETS_ROW_BYTES;
         }
 
-        unboxassets.erase(unboxasset_itr);
-        ram_cost_delta -= 124;
+        claimed_all = unboxassets.begin() == unboxassets.end();
+        if (claimed_all) {
+            //Unboxassets table scope
+            ram_cost_delta -= SCOPE_BYTES;
+        }
     }
 
     if (mint_at_least_one) {
-        atomicassets::assets_t unboxer_assets = atomicassets::get_assets(unboxpack_itr->unboxer);
+        atomicassets::assets_t unboxer_assets = atomicassets::get_assets(unboxpack.unboxer);
         if (unboxer_assets.begin() == unboxer_assets.end()) {
             //Asset table scope
-            ram_cost_delta += 112;
+            ram_cost_delta += SCOPE_BYTES;
         }
     }
 
-    if (unboxassets.begin() == unboxassets.end()) {
-        unboxpacks.erase(unboxpack_itr);
-        //Unboxassets table scope 112 + unboxpacks entry 264
-        ram_cost_delta -= 376;
-
+    if (claimed_all) {
+        ram_cost_delta -= erase_unboxpack(pack_asset_id);
     }
 
     if (ram_cost_delta > 0) {
@@ -96,13 +147,457 @@ ACTION atomicpacks::claimunboxed(
 }
 
 
+/**
+* Claims all results of the packs unboxed by the specified unboxer, up to a maximum of max_claims results
+* The packs are walked using the unboxer index of the unboxpacks table, and the results of each pack
+* are claimed in the order of their origin roll ids. Packs that have not received their randomness yet or that are
+* still being unboxed in multiple steps are skipped, which uses up one unit of max_claims like a claimed result does
+* Packs with the lean unboxpacks flag are not part of the unboxer index and need to be claimed with claimunboxed
+*
+* The RAM balance of each collection is only updated once, after all results have been claimed
+*
+* @required_auth The unboxer or the contract itself
+*/
+ACTION atomicpacks::claimall(
+    name unboxer,
+    uint32_t max_claims
+) {
+    check(has_auth(unboxer) || has_auth(get_self()),
+        "The transaction needs to be authorized either by the unboxer or by the contract itself");
+
+    check(max_claims != 0, "max_claims needs to be positive");
+
+    map <name, int64_t> collection_ram_deltas = {};
+    map <name, name> minting_collections = {};
+    uint32_t claims_left = max_claims;
+    bool claimed_any = false;
+
+    auto unboxpacks_by_unboxer = unboxpacks.get_index<name("unboxer")>();
+    auto unboxpack_itr = unboxpacks_by_unboxer.lower_bound(unboxer.value);
+
+    while (unboxpack_itr != unboxpacks_by_unboxer.end() && unboxpack_itr->unboxer == unboxer && claims_left != 0) {
+        unboxpacks_s unboxpack = *unboxpack_itr;
+        unboxpack_itr++;
+
+        uint32_t claims_before = claims_left;
+        claim_unboxpack_results(unboxpack, claims_left, collection_ram_deltas, minting_collections);
+
+        if (claims_left == claims_before) {
+            claims_left--;
+        } else {
+            claimed_any = true;
+        }
+    }
+
+    check(claimed_any, "The unboxer does not have any results that can be claimed");
+
+    apply_collection_ram_deltas(collection_ram_deltas, minting_collections);
+}
+
+
+/**
+* Claims the results of pending opened packs for their unboxers, so that unclaimed results don't keep
+* the RAM reserved for them forever
+* The opened packs of both the unboxpacks and the leanunboxes tables are walked in the order of their pack asset ids,
+* starting at start_pack_asset_id. Each claimed result and each skipped pack (because its randomness has not been
+* received or not all of its rolls have been drawn) uses up one unit of the budget
+*
+* Returns the pack asset id to start at when calling this action again, which is 0 if the end has been reached
+*
+* @required_auth The contract itself
+*/
+[[eosio::action]] uint64_t atomicpacks::claimpending(
+    uint64_t start_pack_asset_id,
+    uint32_t budget
+) {
+    require_auth(get_self());
+
+    check(budget != 0, "The budget needs to be positive");
+
+    map <name, int64_t> collection_ram_deltas = {};
+    map <name, name> minting_collections = {};
+    uint32_t budget_left = budget;
+
+    auto unboxpack_itr = unboxpacks.lower_bound(start_pack_asset_id);
+    auto leanunbox_itr = leanunboxes.lower_bound(start_pack_asset_id);
+
+    while (budget_left != 0) {
+        bool use_lean = leanunbox_itr != leanunboxes.end() && (unboxpack_itr == unboxpacks.end()
+            || leanunbox_itr->pack_asset_id < unboxpack_itr->pack_asset_id);
+        if (!use_lean && unboxpack_itr == unboxpacks.end()) {
+            break;
+        }
+
+        unboxpacks_s unboxpack = use_lean ? *leanunbox_itr++ : *unboxpack_itr++;
+
+        uint32_t budget_before = budget_left;
+        bool claimed_all = claim_unboxpack_results(unboxpack, budget_left, collection_ram_deltas, minting_collections);
+
+        if (budget_left == budget_before) {
+            budget_left--;
+        } else if (!claimed_all) {
+            //The budget ran out while claiming the results of this pack
+            apply_collection_ram_deltas(collection_ram_deltas, minting_collections);
+            return unboxpack.pack_asset_id;
+        }
+    }
+
+    apply_collection_ram_deltas(collection_ram_deltas, minting_collections);
+
+    uint64_t next_pack_asset_id = 0;
+    if (unboxpack_itr != unboxpacks.end()) {
+        next_pack_asset_id = unboxpack_itr->pack_asset_id;
+    }
+    if (leanunbox_itr != leanunboxes.end()
+        && (next_pack_asset_id == 0 || leanunbox_itr->pack_asset_id < next_pack_asset_id)) {
+        next_pack_asset_id = leanunbox_itr->pack_asset_id;
+    }
+    return next_pack_asset_id;
+}
+
+
+/**
+* Internal function to claim the results of an opened pack, in the order of their origin roll ids,
+* until all results are claimed or claims_left reaches 0
+* Packs that have not received their randomness yet or that are still being unboxed in multiple steps are skipped
+*
+* The RAM cost of the claims is added to the collection_ram_deltas, and the collection of the first asset minted
+* to each unboxer is added to minting_collections. Both need to be applied with apply_collection_ram_deltas
+* afterwards
+*
+* Returns true if all results have been claimed and the unboxpacks entry has been erased
+*/
+bool atomicpacks::claim_unboxpack_results(
+    const unboxpacks_s &unboxpack,
+    uint32_t &claims_left,
+    map <name, int64_t> &collection_ram_deltas,
+    map <name, name> &minting_collections
+) {
+    uint64_t pack_asset_id = unboxpack.pack_asset_id;
+    auto pack_itr = packs.find(unboxpack.pack_id);
+
+    if (unboxcursors.find(pack_asset_id) != unboxcursors.end()) {
+        //Not all rolls of this pack have been drawn yet
+        return false;
+    }
+
+    int64_t &ram_cost_delta = collection_ram_deltas[pack_itr->collection_name];
+    bool claimed_all = false;
+
+    auto claim_result = [&](int32_t template_id) {
+        if (mint_unboxed_template(pack_itr->collection_name, unboxpack.unboxer, template_id)) {
+            minting_collections.insert({unboxpack.unboxer, pack_itr->collection_name});
+            ram_cost_delta += MIN_ASSET_ROW_BYTES;
+        }
+        claims_left--;
+    };
+
+    if (pack_itr->unbox_flags.value_or(0) & UNBOX_FLAG_DEFERRED_RESULTS) {
+        if (!unboxpack.unbox_seed.has_value()) {
+            //The randomness for this pack has not been received yet
+            return false;
+        }
+
+        vector <UNBOX_RESULT> results = get_deferred_results(pack_asset_id, unboxpack);
+        UNBOX_SEED unbox_seed = unboxpack.unbox_seed.value();
+
+        claimed_all = true;
+        for (size_t index = 0; index < results.size(); index++) {
+            uint8_t &claimed_byte = unbox_seed.claimed_rolls[index / 8];
+            if (claimed_byte & (1 << (index % 8))) {
+                continue;
+            }
+            if (claims_left == 0) {
+                claimed_all = false;
+                break;
+            }
+            claim_result(results[index].template_id);
+            claimed_byte |= 1 << (index % 8);
+        }
+
+        if (!claimed_all) {
+            set_unbox_seed(pack_asset_id, unbox_seed);
+        }
+
+    } else if (pack_itr->unbox_flags.value_or(0) & UNBOX_FLAG_PACKED_RESULTS) {
+        auto unboxresults_itr = unboxresults.find(pack_asset_id);
+        if (unboxresults_itr == unboxresults.end()) {
+            //The randomness for this pack has not been received yet
+            return false;
+        }
+
+        vector <UNBOX_RESULT> results = unboxresults_itr->results;
+        uint64_t num_claimed = std::min((uint64_t) claims_left, (uint64_t) results.size());
+
+        for (uint64_t i = 0; i < num_claimed; i++) {
+            claim_result(results[i].template_id);
+        }
+        results.erase(results.begin(), results.begin() + num_claimed);
+
+        ram_cost_delta -= get_unboxresults_ram_bytes(unboxresults_itr->results.size());
+        claimed_all = results.empty();
+
+        if (claimed_all) {
+            unboxresults.erase(unboxresults_itr);
+        } else {
+            unboxresults.modify(unboxresults_itr, same_payer, [&](auto &_unboxresult) {
+                _unboxresult.results = results;
+            });
+            ram_cost_delta += get_unboxresults_ram_bytes(results.size());
+        }
+
+    } else {
+        unboxassets_t unboxassets = get_unboxassets(pack_asset_id);
+        if (unboxassets.begin() == unboxassets.end()) {
+            //The randomness for this pack has not been received yet
+            return false;
+        }
+
+        auto unboxasset_itr = unboxassets.begin();
+        while (unboxasset_itr != unboxassets.end() && claims_left != 0) {
+            claim_result(unboxasset_itr->template_id);
+            unboxasset_itr = unboxassets.erase(unboxasset_itr);
+            ram_cost_delta -= UNBOXASSETS_ROW_BYTES;
+        }
+
+        claimed_all = unboxassets.begin() == unboxassets.end();
+        if (claimed_all) {
+            //Unboxassets table scope
+            ram_cost_delta -= SCOPE_BYTES;
+        }
+    }
+
+    if (claimed_all) {
+        ram_cost_delta -= erase_unboxpack(pack_asset_id);
+    }
+
+    return claimed_all;
+}
+
+
+/**
+* Internal function to apply the RAM costs collected by claim_unboxpack_results or resolve_unboxpack
+* to the collection RAM balances
+* If an unboxer did not have any assets yet, the collection of the first asset minted to them pays for the asset scope
+*/
+void atomicpacks::apply_collection_ram_deltas(
+    map <name, int64_t> &collection_ram_deltas,
+    const map <name, name> &minting_collections
+) {
+    for (const auto &[unboxer, collection_name] : minting_collections) {
+        atomicassets::assets_t unboxer_assets = atomicassets::get_assets(unboxer);
+        if (unboxer_assets.begin() == unboxer_assets.end()) {
+            //Asset table scope
+            collection_ram_deltas[collection_name] += SCOPE_BYTES;
+        }
+    }
+
+    for (const auto &[collection_name, ram_cost_delta] : collection_ram_deltas) {
+        if (ram_cost_delta > 0) {
+            decrease_collection_ram_balance(collection_name, ram_cost_delta,
+                "The collection does not have enough RAM to mint the assets");
+        } else if (ram_cost_delta < 0) {
+            increase_collection_ram_balance(collection_name, -ram_cost_delta);
+        }
+    }
+}
+
+
+/**
+* Continues unboxing a pack that has too many rolls to be unboxed in a single action
+* Each call draws up to MAX_UNBOX_DRAWS_PER_STEP rolls, starting where the previous step stopped.
+* The results can be claimed once all rolls have been drawn
+*
+* @required_auth The unboxer of the pack or the contract itself
+*/
+ACTION atomicpacks::resumeunbox(
+    uint64_t pack_asset_id
+) {
+    unboxpacks_s unboxpack = get_unboxpack(pack_asset_id);
+
+    check(has_auth(unboxpack.unboxer) || has_auth(get_self()),
+        "The transaction needs to be authorized either by the unboxer or by the contract itself");
+
+    auto unboxcursor_itr = unboxcursors.require_find(pack_asset_id,
+        "The pack is not being unboxed in multiple steps");
+
+    auto pack_itr = packs.find(unboxpack.pack_id);
+
+    //Packs that are unboxed in multiple steps never use direct minting
+    map <name, name> minting_collections = {};
+    int64_t freed_ram_bytes = resolve_unboxpack(pack_asset_id, unboxcursor_itr->seed, minting_collections);
+
+    //Only the last step frees RAM, the steps before only move the cursor
+    if (freed_ram_bytes > 0) {
+        increase_collection_ram_balance(pack_itr->collection_name, freed_ram_bytes);
+    }
+}
+
+
+/**
+* Internal function to get the unboxpacks entry of an opened pack
+* Packs with the lean unboxpacks flag have their entry in the leanunboxes table instead
+*/
+atomicpacks::unboxpacks_s atomicpacks::get_unboxpack(
+    uint64_t pack_asset_id
+) {
+    auto unboxpack_itr = unboxpacks.find(pack_asset_id);
+    if (unboxpack_itr != unboxpacks.end()) {
+        return *unboxpack_itr;
+    }
+
+    return leanunboxes.get(pack_asset_id, "No unboxpack with this pack asset id exists");
+}
+
+
+/**
+* Internal function to erase the unboxpacks entry of an opened pack
+* Returns the RAM bytes that were used by the entry, including the seed of packs with deferred results
+*/
+int64_t atomicpacks::erase_unboxpack(
+    uint64_t pack_asset_id
+) {
+    auto get_seed_ram_bytes = [](const unboxpacks_s &unboxpack) -> int64_t {
+        if (!unboxpack.unbox_seed.has_value()) {
+            return 0;
+        }
+        return get_unbox_seed_ram_bytes(unboxpack.unbox_seed.value().claimed_rolls.size() * 8);
+    };
+
+    auto unboxpack_itr = unboxpacks.find(pack_asset_id);
+    if (unboxpack_itr != unboxpacks.end()) {
+        int64_t freed_ram_bytes = UNBOXPACKS_ROW_BYTES + get_seed_ram_bytes(*unboxpack_itr);
+        unboxpacks.erase(unboxpack_itr);
+        return freed_ram_bytes;
+    }
+
+    auto leanunbox_itr = leanunboxes.require_find(pack_asset_id, "No unboxpack with this pack asset id exists");
+    int64_t freed_ram_bytes = LEAN_UNBOXPACKS_ROW_BYTES + get_seed_ram_bytes(*leanunbox_itr);
+    leanunboxes.erase(leanunbox_itr);
+    return freed_ram_bytes;
+}
+
+
+/**
+* Internal function to set the seed and claimed rolls bitmap of an opened pack with deferred results
+*/
+void atomicpacks::set_unbox_seed(
+    uint64_t pack_asset_id,
+    const UNBOX_SEED &unbox_seed
+) {
+    auto set_seed = [&](auto &_unboxpack) {
+        _unboxpack.unbox_seed.emplace(unbox_seed);
+    };
+
+    auto unboxpack_itr = unboxpacks.find(pack_asset_id);
+    if (unboxpack_itr != unboxpacks.end()) {
+        unboxpacks.modify(unboxpack_itr, same_payer, set_seed);
+        return;
+    }
+
+    leanunboxes.modify(leanunboxes.require_find(pack_asset_id, "No unboxpack with this pack asset id exists"),
+        same_payer, set_seed);
+}
+
+
+/**
+* Internal function to mint an asset of the specified template to the unboxer
+* Returns false if no asset was minted, which is the case for the template id -1
+* or if the template has been locked
+*/
+bool atomicpacks::mint_unboxed_template(
+    name collection_name,
+    name unboxer,
+    int32_t template_id
+) {
+    //Template -1 means no asset will be created
+    if (template_id == -1) {
+        return false;
+    }
+
+    TEMPLATE_MINT_DATA template_mint_data = get_template_mint_data(collection_name, template_id);
+
+    //Templates with maximum supply are not supported
+    //Templates are guaranteed not to have a maximum supply when the packs are created
+    //however the template could be locked later, in which case it is skipped here
+    if (template_mint_data.max_supply != 0) {
+        return false;
+    }
+
+    action(
+        permission_level{get_self(), name("active")},
+        atomicassets::ATOMICASSETS_ACCOUNT,
+        name("mintasset"),
+        make_tuple(
+            get_self(),
+            collection_name,
+            template_mint_data.schema_name,
+            template_id,
+            unboxer,
+            (atomicassets::ATTRIBUTE_MAP) {},
+            (atomicassets::ATTRIBUTE_MAP) {},
+            (vector <asset>) {}
+        )
+    ).send();
+
+    return true;
+}
+
+
+/**
+* Internal function to get the schema name and max supply of a template
+*
+* Only the fixed size beginning of the templates row (template_id, schema_name, transferable, burnable,
+* max_supply) is read, so that the potentially large immutable data is neither copied nor deserialized.
+* The max supply is read once per action, because the template could have been locked since the pack was created.
+* Results are cached for the rest of the action, as the same template is usually minted multiple times
+*/
+atomicpacks::TEMPLATE_MINT_DATA atomicpacks::get_template_mint_data(
+    name collection_name,
+    int32_t template_id
+) {
+    auto cache_itr = template_mint_cache.find({collection_name.value, template_id});
+    if (cache_itr != template_mint_cache.end()) {
+        return cache_itr->second;
+    }
+
+    int32_t template_db_itr = internal_use_do_not_use::db_find_i64(
+        atomicassets::ATOMICASSETS_ACCOUNT.value,
+        collection_name.value,
+        name("templates").value,
+        (uint64_t) template_id
+    );
+    check(template_db_itr >= 0, "No template with the id " + to_string(template_id) + " exists within the collection");
+
+    char buffer[TEMPLATE_MINT_DATA_BYTES];
+    int32_t read_size = internal_use_do_not_use::db_get_i64(template_db_itr, buffer, sizeof(buffer));
+    check(read_size == sizeof(buffer), "Unable to read the template " + to_string(template_id));
+
+    int32_t read_template_id;
+    bool transferable;
+    bool burnable;
+    TEMPLATE_MINT_DATA template_mint_data;
+
+    datastream <const char *> ds(buffer, sizeof(buffer));
+    ds >> read_template_id >> template_mint_data.schema_name >> transferable >> burnable >> template_mint_data.max_supply;
+
+    template_mint_cache[{collection_name.value, template_id}] = template_mint_data;
+    return template_mint_data;
+}
+
+
 /**
 * This action is called by the rng oracle and provides the randomness for unboxing a pack
 * The assoc id is equal to the asset id of the pack that is being unboxed
+* If multiple packs were opened with a single transfer, the assoc id is the asset id of the first pack,
+* and each pack is unboxed with its own seed derived from the random value
 * 
 * The unboxed assets are not immediately minted but instead placed in the unboxassets table with
 * the scope <asset id of the pack that is being unboxed> and need to be claimed using the claimunboxed action
 * This functionality is split in an effort to prevent transaction timeouts
+* Packs that were completed with the direct mint flag have few enough rolls to mint the assets immediately
+* Packs that were completed with the deferred results flag only store the seed, independent of their number of rolls
+* Packs with more than MAX_UNBOX_DRAWS_PER_STEP rolls are only partly unboxed and need to be continued with resumeunbox
 * 
 * @required_auth rng oracle account
 */
@@ -112,51 +607,310 @@ ACTION atomicpacks::receiverand(
 ) {
     require_auth(orng::ORNG_CONTRACT);
 
-    RandomnessProvider randomness_provider(random_value);
+    auto pack_itr = packs.find(get_unboxpack(assoc_id).pack_id);
+
+    //job table entry in the rng oracle contract has been erased
+    int64_t freed_ram_bytes = ORNG_JOBS_ROW_BYTES;
 
+    //All packs of a batch are unboxed by the same unboxer, whose asset scope is only paid for once
+    map <name, name> minting_collections = {};
 
-    auto unboxpack_itr = unboxpacks.find(assoc_id);
-    auto pack_itr = packs.find(unboxpack_itr->pack_id);
+    auto unboxbatch_itr = unboxbatches.find(assoc_id);
+    if (unboxbatch_itr == unboxbatches.end()) {
+        freed_ram_bytes += resolve_unboxpack(assoc_id, random_value, minting_collections);
 
+    } else {
+        array<uint8_t, 40> seed_data;
+        memcpy(seed_data.data(), random_value.extract_as_byte_array().data(), 32);
 
-    //job table entry in the rng oracle contract has been erased
-    increase_collection_ram_balance(pack_itr->collection_name, 144);
+        for (uint64_t pack_asset_id : unboxbatch_itr->pack_asset_ids) {
+            memcpy(seed_data.data() + 32, &pack_asset_id, sizeof(pack_asset_id));
+            freed_ram_bytes += resolve_unboxpack(pack_asset_id,
+                eosio::sha256((char *) seed_data.data(), seed_data.size()), minting_collections);
+        }
+
+        freed_ram_bytes += get_unboxbatches_ram_bytes(unboxbatch_itr->pack_asset_ids.size());
+        unboxbatches.erase(unboxbatch_itr);
+    }
+
+    map <name, int64_t> collection_ram_deltas = {{pack_itr->collection_name, -freed_ram_bytes}};
+    apply_collection_ram_deltas(collection_ram_deltas, minting_collections);
+}
+
+
+/**
+* Internal function to draw the results of a pack from the provided seed
+* Drawing starts at the roll with the origin roll id first_roll_id and stops after max_draws results, with
+* rand_position being the position of the randomness provider, which is advanced by the values that were used.
+* This allows drawing the results of a pack in multiple steps, which gives the same results as drawing them at once
+*
+* The results are sorted by their origin roll ids. Returns true if the last roll of the pack has been drawn
+*/
+bool atomicpacks::draw_unbox_results(
+    uint64_t pack_id,
+    checksum256 seed,
+    uint64_t &rand_position,
+    uint64_t first_roll_id,
+    uint64_t max_draws,
+    vector <uint64_t> &result_roll_ids,
+    vector <int32_t> &result_template_ids
+) {
+    RandomnessProvider randomness_provider(seed, rand_position);
+    bool drawn_all = true;
+
+    bundlechunks_t bundlechunks = get_bundlechunks(pack_id);
+
+    //Unbox steps start at the first roll id of a chunk, otherwise the chunk with the next lower key is used
+    auto chunk_itr = bundlechunks.find(first_roll_id);
+    if (chunk_itr == bundlechunks.end()) {
+        chunk_itr = bundlechunks.upper_bound(first_roll_id);
+        if (chunk_itr != bundlechunks.begin()) {
+            chunk_itr--;
+        }
+    }
+
+    if (chunk_itr != bundlechunks.end()) {
+        struct ALIAS_DRAW {
+            size_t   alias_table_index;
+            uint32_t total_odds;
+            uint64_t origin_roll_id;
+        };
+
+        //A single draw selects both the column of the alias table and the position within that column
+        vector <vector <ALIAS_ENTRY>> alias_tables = {};
+        vector <ALIAS_DRAW> draws = {};
+        vector <uint64_t> bounds = {};
 
+        while (drawn_all) {
+            for (const BUNDLE_ROLL &roll : chunk_itr->rolls) {
+                //The first roll id can be in the middle of a roll that is drawn multiple times
+                if (roll.roll_id + roll.count <= first_roll_id) {
+                    continue;
+                }
+                if (draws.size() == max_draws) {
+                    drawn_all = false;
+                    break;
+                }
 
-    packrolls_t packrolls = get_packrolls(unboxpack_itr->pack_id);
-    unboxassets_t unboxassets = get_unboxassets(unboxpack_itr->pack_asset_id);
+                alias_tables.push_back(decode_alias_table(roll.alias_table, roll.total_odds));
+                uint64_t bound = alias_tables.back().size() * (uint64_t) roll.total_odds;
+
+                uint64_t origin_roll_id = std::max(first_roll_id, roll.roll_id);
+                for (; origin_roll_id < roll.roll_id + roll.count; origin_roll_id++) {
+                    if (draws.size() == max_draws) {
+                        drawn_all = false;
+                        break;
+                    }
+                    draws.push_back({alias_tables.size() - 1, roll.total_odds, origin_roll_id});
+                    bounds.push_back(bound);
+                }
+                if (!drawn_all) {
+                    break;
+                }
+            }
+
+            if (!drawn_all || chunk_itr->last_chunk) {
+                break;
+            }
+            //The next chunk is only read if there are draws left for it
+            if (draws.size() == max_draws) {
+                drawn_all = false;
+                break;
+            }
+            chunk_itr++;
+            check(chunk_itr != bundlechunks.end(), "The bundle of the pack is incomplete");
+        }
+
+        vector <uint64_t> rands;
+        randomness_provider.fill(rands, bounds);
+
+        for (size_t i = 0; i < draws.size(); i++) {
+            result_roll_ids.push_back(draws[i].origin_roll_id);
+            result_template_ids.push_back(get_alias_outcome(
+                alias_tables[draws[i].alias_table_index].data(), draws[i].total_odds, rands[i]));
+        }
+
+    } else {
+        //Packs that were completed before alias tables were introduced don't have any,
+        //so their rolls are evaluated by summing up the odds of the outcomes
+        packrolls_t packrolls = get_packrolls(pack_id);
+
+        uint64_t num_draws = 0;
+        for (auto roll_itr = packrolls.lower_bound(first_roll_id); roll_itr != packrolls.end(); roll_itr++) {
+            if (num_draws == max_draws) {
+                drawn_all = false;
+                break;
+            }
+            num_draws++;
+
+            uint32_t rand = randomness_provider.get_rand(roll_itr->total_odds);
+            uint32_t summed_odds = 0;
+
+            for (const OUTCOME &outcome : get_roll_outcomes(*roll_itr)) {
+                summed_odds += outcome.odds;
+                if (summed_odds > rand) {
+                    result_roll_ids.push_back(roll_itr->roll_id);
+                    result_template_ids.push_back(outcome.template_id);
+                    break;
+                }
+            }
+        }
+    }
 
+    rand_position = randomness_provider.get_position();
+    return drawn_all;
+}
+
+
+/**
+* Internal function to generate the results of an unboxed pack using the provided seed
+* The results are placed in the unboxassets table (or in a single unboxresults row if the pack has the packed
+* results flag), or minted directly if the pack has the direct mint flag, and the pack asset is burned
+* For packs with the deferred results flag, only the seed is stored
+*
+* Packs with more than MAX_UNBOX_DRAWS_PER_STEP rolls are unboxed in multiple steps. The progress is stored in
+* the unboxcursors table, and the provided seed is only used for the first step. logresult is sent after the last step
+*
+* For directly minted assets, the unboxer is added to minting_collections instead of paying for the asset scope here,
+* because the scope is only created once for all packs opened in the same transaction
+*
+* Returns the amount of RAM bytes that were reserved for this pack but are no longer needed
+*/
+int64_t atomicpacks::resolve_unboxpack(
+    uint64_t pack_asset_id,
+    checksum256 seed,
+    map <name, name> &minting_collections
+) {
+    unboxpacks_s unboxpack = get_unboxpack(pack_asset_id);
+    auto pack_itr = packs.find(unboxpack.pack_id);
+
+    if (pack_itr->unbox_flags.value_or(0) & UNBOX_FLAG_DEFERRED_RESULTS) {
+        //RAM has already been paid when the pack was received / burned with the reserved_ram_bytes
+        uint64_t roll_count = get_unbox_profile(*pack_itr).roll_count;
+        set_unbox_seed(pack_asset_id, {
+            .seed = seed,
+            .claimed_rolls = vector <uint8_t>((roll_count + 7) / 8, 0)
+        });
+
+        action(
+            permission_level{get_self(), name("active")},
+            atomicassets::ATOMICASSETS_ACCOUNT,
+            name("burnasset"),
+            std::make_tuple(
+                get_self(),
+                pack_asset_id
+            )
+        ).send();
+
+        return 0;
+    }
+
+    auto unboxcursor_itr = unboxcursors.find(pack_asset_id);
+    bool is_first_step = unboxcursor_itr == unboxcursors.end();
+
+    checksum256 step_seed = is_first_step ? seed : unboxcursor_itr->seed;
+    uint64_t rand_position = is_first_step ? 0 : unboxcursor_itr->rand_position;
+    uint64_t first_roll_id = is_first_step ? 0 : unboxcursor_itr->next_roll_id;
+
+    vector <uint64_t> result_roll_ids = {};
     vector <int32_t> result_template_ids = {};
+    bool drawn_all = draw_unbox_results(unboxpack.pack_id, step_seed, rand_position, first_roll_id,
+        MAX_UNBOX_DRAWS_PER_STEP, result_roll_ids, result_template_ids);
+
 
-    for (auto roll_itr = packrolls.begin(); roll_itr != packrolls.end(); roll_itr++) {
+    int64_t freed_ram_bytes = 0;
+
+    if (pack_itr->unbox_flags.value_or(0) & UNBOX_FLAG_DIRECT_MINT) {
+        int64_t used_ram_bytes = 0;
+        for (int32_t template_id : result_template_ids) {
+            if (mint_unboxed_template(pack_itr->collection_name, unboxpack.unboxer, template_id)) {
+                minting_collections.insert({unboxpack.unboxer, pack_itr->collection_name});
+                used_ram_bytes += MIN_ASSET_ROW_BYTES;
+            }
+        }
 
-        uint32_t rand = randomness_provider.get_rand(roll_itr->total_odds);
-        uint32_t summed_odds = 0;
+        //The reserved bytes also include the unboxpacks entry and the asset scope, which is paid for separately
+        erase_unboxpack(pack_asset_id);
+        freed_ram_bytes = get_unbox_profile(*pack_itr).reserved_ram_bytes - used_ram_bytes;
 
-        for (const OUTCOME &outcome : roll_itr->outcomes) {
-            summed_odds += outcome.odds;
-            if (summed_odds > rand) {
-                //RAM has already been paid when the pack was received / burned with the reserved_ram_bytes
-                unboxassets.emplace(get_self(), [&](auto &_unboxasset) {
-                    _unboxasset.origin_roll_id = roll_itr->roll_id;
-                    _unboxasset.template_id = outcome.template_id;
+    } else if (pack_itr->unbox_flags.value_or(0) & UNBOX_FLAG_PACKED_RESULTS) {
+        //RAM has already been paid when the pack was received / burned with the reserved_ram_bytes
+        auto add_results = [&](auto &_unboxresult) {
+            _unboxresult.pack_asset_id = pack_asset_id;
+            for (size_t i = 0; i < result_roll_ids.size(); i++) {
+                _unboxresult.results.push_back({
+                    .origin_roll_id = result_roll_ids[i],
+                    .template_id = result_template_ids[i]
                 });
-                result_template_ids.push_back(outcome.template_id);
-                break;
             }
+        };
+
+        auto unboxresults_itr = unboxresults.find(pack_asset_id);
+        if (unboxresults_itr == unboxresults.end()) {
+            unboxresults.emplace(get_self(), add_results);
+        } else {
+            unboxresults.modify(unboxresults_itr, same_payer, add_results);
+        }
+
+    } else {
+        unboxassets_t unboxassets = get_unboxassets(pack_asset_id);
+
+        for (size_t i = 0; i < result_roll_ids.size(); i++) {
+            //RAM has already been paid when the pack was received / burned with the reserved_ram_bytes
+            unboxassets.emplace(get_self(), [&](auto &_unboxasset) {
+                _unboxasset.origin_roll_id = result_roll_ids[i];
+                _unboxasset.template_id = result_template_ids[i];
+            });
         }
     }
 
 
-    action(
-        permission_level{get_self(), name("active")},
-        atomicassets::ATOMICASSETS_ACCOUNT,
-        name("burnasset"),
-        std::make_tuple(
-            get_self(),
-            assoc_id
-        )
-    ).send();
+    if (is_first_step) {
+        action(
+            permission_level{get_self(), name("active")},
+            atomicassets::ATOMICASSETS_ACCOUNT,
+            name("burnasset"),
+            std::make_tuple(
+                get_self(),
+                pack_asset_id
+            )
+        ).send();
+    }
+
+    if (!drawn_all) {
+        //RAM has already been paid when the pack was received / burned with the reserved_ram_bytes
+        auto set_cursor = [&](auto &_unboxcursor) {
+            _unboxcursor.pack_asset_id = pack_asset_id;
+            _unboxcursor.seed = step_seed;
+            _unboxcursor.rand_position = rand_position;
+            _unboxcursor.next_roll_id = result_roll_ids.back() + 1;
+        };
+
+        if (is_first_step) {
+            unboxcursors.emplace(get_self(), set_cursor);
+        } else {
+            unboxcursors.modify(unboxcursor_itr, same_payer, set_cursor);
+        }
+        return freed_ram_bytes;
+    }
+
+    if (!is_first_step) {
+        unboxcursors.erase(unboxcursor_itr);
+        freed_ram_bytes += UNBOXCURSORS_ROW_BYTES;
+
+        //The results of the previous steps are logged as well
+        //They can't have been claimed yet, because claiming is only possible after the last step
+        result_template_ids.clear();
+        if (pack_itr->unbox_flags.value_or(0) & UNBOX_FLAG_PACKED_RESULTS) {
+            for (const UNBOX_RESULT &result : unboxresults.get(pack_asset_id).results) {
+                result_template_ids.push_back(result.template_id);
+            }
+        } else {
+            for (const unboxassets_s &unboxasset : get_unboxassets(pack_asset_id)) {
+                result_template_ids.push_back(unboxasset.template_id);
+            }
+        }
+    }
 
 
     action(
@@ -164,19 +918,65 @@ ACTION atomicpacks::receiverand(
         get_self(),
         name("logresult"),
         std::make_tuple(
-            assoc_id,
-            unboxpack_itr->pack_id,
+            pack_asset_id,
+            pack_itr->pack_id,
             result_template_ids
         )
     ).send();
+
+    return freed_ram_bytes;
+}
+
+
+/**
+* Internal function to draw the results of an opened pack with deferred results from its stored seed
+* The results are logged when they are drawn for the first time, which is when the first roll is claimed
+*/
+vector <atomicpacks::UNBOX_RESULT> atomicpacks::get_deferred_results(
+    uint64_t pack_asset_id,
+    const unboxpacks_s &unboxpack
+) {
+    check(unboxpack.unbox_seed.has_value(), "The results of this pack have not been received yet");
+    const UNBOX_SEED &unbox_seed = unboxpack.unbox_seed.value();
+
+    vector <uint64_t> result_roll_ids = {};
+    vector <int32_t> result_template_ids = {};
+    //The bitmap has at least one bit for each roll, so all rolls are drawn
+    uint64_t rand_position = 0;
+    draw_unbox_results(unboxpack.pack_id, unbox_seed.seed, rand_position, 0, unbox_seed.claimed_rolls.size() * 8,
+        result_roll_ids, result_template_ids);
+
+    bool claimed_any = std::any_of(unbox_seed.claimed_rolls.begin(), unbox_seed.claimed_rolls.end(),
+        [](uint8_t claimed_byte) { return claimed_byte != 0; });
+    if (!claimed_any) {
+        action(
+            permission_level{get_self(), name("active")},
+            get_self(),
+            name("logresult"),
+            std::make_tuple(
+                pack_asset_id,
+                unboxpack.pack_id,
+                result_template_ids
+            )
+        ).send();
+    }
+
+    vector <UNBOX_RESULT> results = {};
+    for (size_t i = 0; i < result_roll_ids.size(); i++) {
+        results.push_back({
+            .origin_roll_id = result_roll_ids[i],
+            .template_id = result_template_ids[i]
+        });
+    }
+    return results;
 }
 
 
 /**
 * This function is called when AtomicAssets assets are transferred to the pack contract
 
-* This is used to unbox packs, by transferring exactly one pack to the pack contract
-* The pack asset is then burned and the rng oracle is called to request a random value
+* This is used to unbox packs, by transferring one or more packs of the same collection to the pack contract
+* The pack assets are then burned and the rng oracle is called to request a single random value for all of them
 */
 void atomicpacks::receive_asset_transfer(
     name from,
@@ -188,55 +988,75 @@ void atomicpacks::receive_asset_transfer(
         return;
     }
 
-    check(asset_ids.size() == 1, "Only one pack can be opened at a time");
+    check(asset_ids.size() != 0, "At least one pack needs to be opened");
+    check(asset_ids.size() <= MAX_PACKS_PER_UNBOX,
+        "Can't open more than " + to_string(MAX_PACKS_PER_UNBOX) + " packs at a time");
     check(memo == "unbox", "Invalid memo");
 
     atomicassets::assets_t own_assets = atomicassets::get_assets(get_self());
-    auto asset_itr = own_assets.find(asset_ids[0]);
-
-    check(asset_itr->template_id != -1, "The transferred asset does not belong to a template");
     auto packs_by_template_id = packs.get_index<name("templateid")>();
-    auto pack_itr = packs_by_template_id.require_find(asset_itr->template_id,
-        "The transferred asset's template does not belong to any pack");
-    
-    check(pack_itr->unlock_time <= current_time_point().sec_since_epoch(),
-        "The pack has not unlocked yet");
-
-
-    //Get signing value from transaction id
-    //As this is only used as the signing value for the randomness oracle, it does not matter that this
-    //signing value is not truly random
-    size_t size = transaction_size();
-    char buf[size];
-    uint32_t read = read_transaction(buf, size);
-    check(size == read, "Signing value generation: read_transaction() has failed.");
-    checksum256 tx_id = eosio::sha256(buf, read);
-    uint64_t signing_value;
-    memcpy(&signing_value, tx_id.data(), sizeof(signing_value));
-
-    //Check if the signing_value was already used.
-    //If that is the case, increment the signing_value until a non-used value is found
-    while (orng::signvals.find(signing_value) != orng::signvals.end()) {
-        signing_value++;
-    }
-
-    //This amount of RAM will be needed to fill the packrolls table when the randomness is received
-    //112 for the unboxassets scope
-    //124 for each unboxassets row (112 for pk + 8 + 4)
-    packrolls_t packrolls = get_packrolls(pack_itr->pack_id);
-    int64_t reserved_ram_bytes = 112 + std::distance(packrolls.begin(), packrolls.end()) * 124;
-
-    //264 for the unboxpacks entry (112 for pk + 3 x 8 for data + 128 for sk)
-    //120 for the signvals entry in the rng oracle contract (112 pk + 8 for data)
-    //144 for the jobs entry in the rng oracle contract (112 pk + 4 x 8 for data)
-    decrease_collection_ram_balance(pack_itr->collection_name, reserved_ram_bytes + 264 + 120 + 144,
-        "The collection does not have enough RAM to pay for the reserved bytes");
 
-    unboxpacks.emplace(get_self(), [&](auto &_unboxpack) {
-        _unboxpack.pack_asset_id = asset_ids[0];
-        _unboxpack.pack_id = pack_itr->pack_id;
-        _unboxpack.unboxer = from;
-    });
+    name collection_name;
+    //Rolls that are drawn when the randomness is received, summed over all packs of the transfer
+    uint64_t total_draws = 0;
+
+    for (uint64_t asset_id : asset_ids) {
+        auto asset_itr = own_assets.find(asset_id);
+
+        check(asset_itr->template_id != -1, "The transferred asset does not belong to a template");
+        auto pack_itr = packs_by_template_id.require_find(asset_itr->template_id,
+            "The transferred asset's template does not belong to any pack");
+
+        check(pack_itr->unlock_time <= current_time_point().sec_since_epoch(),
+            "The pack has not unlocked yet");
+
+        if (asset_id == asset_ids[0]) {
+            collection_name = pack_itr->collection_name;
+        } else {
+            check(pack_itr->collection_name == collection_name,
+                "All packs opened at the same time must belong to the same collection");
+        }
+
+        UNBOX_PROFILE unbox_profile = get_unbox_profile(*pack_itr);
+        //Packs with deferred results are only drawn when they are claimed
+        if (!(pack_itr->unbox_flags.value_or(0) & UNBOX_FLAG_DEFERRED_RESULTS)) {
+            total_draws += unbox_profile.roll_count;
+            check(asset_ids.size() == 1 || total_draws <= MAX_UNBOX_DRAWS_PER_STEP,
+                "Packs opened at the same time can't have more than " + to_string(MAX_UNBOX_DRAWS_PER_STEP)
+                + " rolls in total");
+        }
+
+        //The RAM needed for the results and the unboxpacks entry is reserved until the randomness is received
+        decrease_collection_ram_balance(collection_name, unbox_profile.reserved_ram_bytes,
+            "The collection does not have enough RAM to pay for the reserved bytes");
+
+        auto set_unboxpack = [&](auto &_unboxpack) {
+            _unboxpack.pack_asset_id = asset_id;
+            _unboxpack.pack_id = pack_itr->pack_id;
+            _unboxpack.unboxer = from;
+        };
+        if (pack_itr->unbox_flags.value_or(0) & UNBOX_FLAG_LEAN_UNBOXPACKS) {
+            leanunboxes.emplace(get_self(), set_unboxpack);
+        } else {
+            unboxpacks.emplace(get_self(), set_unboxpack);
+        }
+    }
+
+
+    //signvals and jobs entries in the rng oracle contract
+    int64_t request_ram_bytes = ORNG_SIGNVALS_ROW_BYTES + ORNG_JOBS_ROW_BYTES;
+
+    if (asset_ids.size() > 1) {
+        request_ram_bytes += get_unboxbatches_ram_bytes(asset_ids.size());
+
+        unboxbatches.emplace(get_self(), [&](auto &_unboxbatch) {
+            _unboxbatch.assoc_id = asset_ids[0];
+            _unboxbatch.pack_asset_ids = asset_ids;
+        });
+    }
+
+    decrease_collection_ram_balance(collection_name, request_ram_bytes,
+        "The collection does not have enough RAM to pay for the reserved bytes");
 
     action(
         permission_level{get_self(), name("active")},
@@ -244,7 +1064,7 @@ void atomicpacks::receive_asset_transfer(
         name("requestrand"),
         std::make_tuple(
             asset_ids[0], //used as assoc id
-            signing_value,
+            get_signing_value(asset_ids[0]),
             get_self()
         )
     ).send();